@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+namespace app
+{
+    // Number of heap allocations made by the calling thread through global operator new.
+    // Threads count separately, so evaluators running in parallel don't share the counters
+    size_t getAllocationCount();
+
+    // Total size of these allocations in bytes
+    size_t getAllocatedSize();
+}
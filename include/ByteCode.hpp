@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 #include <variant>
 #include <optional>
 
@@ -46,15 +48,23 @@ namespace app
 
         IF,         // bool, ptr (if true), ptr (if false), IF ->
         JMP,        // ptr, JMP ->
-        CALL,       // var, CALL -> [push current ptr]
+        CALL,       // number (argument count), var, CALL -> [push current ptr]
         RET,        // RET -> [pop current ptr]
 
-        PUSHARG,    // val/var, PUSHARG ->
-        POPARG,     // POPARG -> val/var
+        PUSHARG,    // val/var, PUSHARG -> [append to the callee frame]
+        DECLARG,    // var, DECLARG -> [bind next argument]
+        DECLARGREF, // var, DECLARGREF -> [bind next argument by reference]
 
         DEFBLOCK,	// DEFBLOCK ->
         DELBLOCK,	// DELBLOCK ->
 
+        // Superinstructions
+        INCVAR,         // var, number, INCVAR ->                                   var = var + number
+        LT_JMP,         // val/var, val/var, ptr (if true), ptr (if false), LT_JMP ->  LT, IF
+        CALL_MEMBER,    // number, val/var, var, CALL_MEMBER -> [push current ptr]    STRUCTREF, CALL
+
+        TAILCALL,   // number, var, TAILCALL -> [reuse current frame]
+
         Count,
     };
 
@@ -89,7 +99,32 @@ namespace app
 
     using Pointer = size_t;
 
-    using ByteCodeItem = std::variant<std::nullopt_t, bool, double, std::string, std::string_view, OpCode, Pointer>;
+    // Variables resolved at compile time. The name is kept for error messages, packed with
+    // the index so a slot is not larger than a symbol on the evaluator stack
+    struct LocalSlot { uint32_t index; uint32_t nameSize; const char* name; };     // slot in the current function frame
+    struct GlobalSlot { uint32_t index; uint32_t nameSize; const char* name; };    // slot of the top level code
+
+    template<typename Slot>
+    Slot makeSlot(const size_t index, const std::string_view name)
+    {
+        return Slot{ static_cast<uint32_t>(index), static_cast<uint32_t>(name.size()), name.data() };
+    }
+
+    template<typename Slot>
+    std::string_view getName(const Slot& slot)
+    {
+        return std::string_view{ slot.name, slot.nameSize };
+    }
+
+    using ByteCodeItem = std::variant<std::nullopt_t, bool, double, std::string, std::string_view, OpCode, Pointer,
+        LocalSlot, GlobalSlot>;
 
     void print(const ByteCodeItem & item);
+
+    // Removes marked items and fixes pointers. Pointers to removed items are moved to the next item
+    void removeItems(std::vector<ByteCodeItem>& byteCode, const std::vector<bool>& removed);
+
+    // Inserts items before given positions (sorted) and fixes pointers. Pointers keep referencing
+    // the original items, so inserted items are reached only by falling through
+    void insertItems(std::vector<ByteCodeItem>& byteCode, std::vector<std::pair<size_t, ByteCodeItem>> items);
 }
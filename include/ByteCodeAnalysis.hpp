@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include "ByteCode.hpp"
+
+namespace app
+{
+    namespace bytecode_analysis {
+        constexpr size_t NO_INDEX = static_cast<size_t>(-1);
+
+        struct Operand
+        {
+            size_t consumer = NO_INDEX; // index of the op which pops this item
+            size_t slot = 0;            // 0 - top of the stack, 1 - below top, etc.
+        };
+
+        inline bool isOp(const ByteCodeItem& item, const OpCode op)
+        {
+            const auto* value = std::get_if<OpCode>(&item);
+            return value != nullptr && *value == op;
+        }
+
+        // Ops which declare the variable named by their operand
+        inline bool isDeclaration(const ByteCodeItem& item)
+        {
+            const auto* value = std::get_if<OpCode>(&item);
+            return value != nullptr && (*value == OpCode::DECLVAR || *value == OpCode::DECLFUN ||
+                *value == OpCode::DECLARG || *value == OpCode::DECLARGREF);
+        }
+
+        // Literals, variables and ops which leave a result on the value stack
+        bool pushesValue(const ByteCodeItem& item);
+
+        // Marks all positions which are referenced by pointers (including end of the code)
+        std::vector<bool> findJumpTargets(const std::vector<ByteCodeItem>& byteCode);
+
+        // Linear simulation of the value stack. For each item which pushes a value
+        // finds the op which consumes it. Stack is considered empty at jump targets
+        std::vector<Operand> analyzeOperands(const std::vector<ByteCodeItem>& byteCode);
+
+        // Block depth of each instruction reachable from the program entry.
+        // Function bodies are not entered, unknown or ambiguous depth is NO_INDEX
+        std::vector<size_t> analyzeBlockDepth(const std::vector<ByteCodeItem>& byteCode);
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+#include "CoreFunction.hpp"
+#include "CoreObject.hpp"
+
+namespace app
+{
+    // Descriptor shared by all objects of a core type: field layout of new objects and
+    // the method table. Methods are created once per class instead of once per object
+    class CoreClass final
+    {
+    public:
+        CoreClass(const std::vector<std::string>& fields,
+            const std::vector<std::pair<std::string, CoreMethod::Function>>& methods);
+
+        CoreClass(const CoreClass&) = delete;
+        CoreClass& operator=(const CoreClass&) = delete;
+
+        const CoreObjectShape* getShape() const;
+        const Symbol* findMethod(const std::string& name) const;
+
+    private:
+        CoreObjectShape m_root;
+        const CoreObjectShape* m_shape;
+
+        std::unordered_map<std::string, Symbol> m_methods;
+    };
+}
@@ -6,7 +6,7 @@
 
 namespace app
 {
-    class CoreFunction
+    class CoreFunction : public RefCounted
     {
     public:
         virtual void call(Evaluator& evaluator) = 0;
@@ -30,4 +30,47 @@ namespace app
     private:
         std::function<void(Evaluator&)> m_function;
     };
+
+    // Method shared by all objects of a class. Called on the object set by the evaluator
+    class CoreMethod final : public CoreFunction
+    {
+    public:
+        using Function = std::function<void(Evaluator&, CoreObject&)>;
+
+        explicit CoreMethod(const Function& function) :
+            m_function(function)
+        {}
+
+        void call(Evaluator& evaluator) override
+        {
+            const auto object = evaluator.takeMethodObject();
+            if (object == nullptr) {
+                throw std::runtime_error{ "Unable to call method without object" };
+            }
+
+            m_function(evaluator, *object);
+        }
+
+    private:
+        Function m_function;
+    };
+
+    // Method taken from an object without calling it
+    class BoundCoreMethod final : public CoreFunction
+    {
+    public:
+        BoundCoreMethod(const CoreObjectPtr& object, const CoreFunctionPtr& method) :
+            m_object(object), m_method(method)
+        {}
+
+        void call(Evaluator& evaluator) override
+        {
+            evaluator.setMethodObject(m_object);
+            m_method->call(evaluator);
+        }
+
+    private:
+        CoreObjectPtr m_object;
+        CoreFunctionPtr m_method;
+    };
 }
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace app
+{
+    class CoreObject;
+
+    // Heap of core objects, one per thread. Objects must be released on the thread which
+    // created them. Memory is bump allocated from chunks and recycled by size class.
+    // New objects live in the nursery, minor collections free its unreachable cycles and
+    // promote the survivors to the old generation, which is collected when it doubles.
+    // Collections use trial deletion: reference counts already include every evaluator
+    // stack, register and scope block, so references not held by objects are the roots
+    // and objects never move
+    class CoreHeap final
+    {
+    public:
+        static constexpr size_t NURSERY_SIZE = 4096;
+        static constexpr size_t MIN_OLD_GENERATION_SIZE = 16384;
+
+        struct Statistics
+        {
+            size_t heapSize = 0;            // bytes reserved for objects
+            size_t nurseryObjects = 0;
+            size_t oldObjects = 0;
+
+            size_t minorCollections = 0;
+            size_t majorCollections = 0;
+            size_t collectedObjects = 0;
+
+            std::chrono::nanoseconds totalPause{ 0 };
+            std::chrono::nanoseconds maxPause{ 0 };
+        };
+
+        static CoreHeap& get();
+
+        CoreHeap(const CoreHeap&) = delete;
+        CoreHeap& operator=(const CoreHeap&) = delete;
+
+        void* allocate(size_t size);
+        void deallocate(void* memory, size_t size) noexcept;
+
+        void add(CoreObject& object);
+        void remove(CoreObject& object) noexcept;
+
+        // Deletes an object whose last reference was released. Objects released by its
+        // destructor are deleted after it returns, so long chains don't nest destructors
+        void destroy(const CoreObject& object) noexcept;
+
+        // Frees unreachable cycles of the nursery, or of the whole heap if full is set.
+        // Returns the number of freed objects
+        size_t collect(bool full);
+
+        const Statistics& getStatistics() const;
+
+    private:
+        static constexpr size_t CHUNK_SIZE = 64 * 1024;
+        static constexpr size_t SIZE_CLASS_STEP = 16;
+        static constexpr size_t MAX_SMALL_SIZE = 512;
+
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        CoreHeap() = default;
+
+        void collectIfNeeded();
+
+        std::vector<std::unique_ptr<std::byte[]>> m_chunks;
+        std::byte* m_bumpPointer = nullptr;
+        std::byte* m_bumpEnd = nullptr;
+        FreeBlock* m_freeBlocks[MAX_SMALL_SIZE / SIZE_CLASS_STEP] = {};
+
+        CoreObject* m_nursery = nullptr;
+        CoreObject* m_oldGeneration = nullptr;
+        size_t m_oldGenerationLimit = MIN_OLD_GENERATION_SIZE;
+        bool m_collecting = false;
+
+        std::vector<const CoreObject*> m_releasedObjects;
+        bool m_destroying = false;
+
+        Statistics m_statistics;
+    };
+}
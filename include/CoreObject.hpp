@@ -1,36 +1,132 @@
 #pragma once
 
+#include <vector>
+#include <memory_resource>
+
 #include "Symbol.hpp"
 
 namespace app
 {
-    class CoreObject
+    class CoreClass;
+
+    // Field layout shared by all objects which have the same fields in the same order.
+    // Shapes are never destroyed, so their addresses identify layouts in member caches
+    class CoreObjectShape final
+    {
+    public:
+        explicit CoreObjectShape(const CoreClass* coreClass = nullptr);
+
+        static const CoreObjectShape* getEmpty();
+
+        // Shape with one more field, created once for each distinct name
+        const CoreObjectShape* add(const std::string& name) const;
+
+        std::optional<size_t> find(const std::string& name) const;
+        size_t getSize() const;
+
+        // Class which provides methods of the objects, can be null
+        const CoreClass* getClass() const;
+
+    private:
+        const CoreClass* m_class;
+
+        std::unordered_map<std::string, size_t> m_indices;
+        mutable std::unordered_map<std::string, std::unique_ptr<CoreObjectShape>> m_transitions;
+    };
+
+    // Inline cache of a single member access instruction
+    struct MemberCache
+    {
+        const CoreObjectShape* shape = nullptr;
+        size_t index = 0;               // field index
+        const Symbol* method = nullptr; // method of the class if the member is not a field
+    };
+
+    // Reference counted object of the host, allocated in the CoreHeap. Objects which only
+    // reference each other are freed by its collections. The object and its members are
+    // charged to the memory account which is current when it is created
+    class CoreObject : public RefCounted
     {
     public:
-        virtual Symbol getMember(const std::string& name);
+        CoreObject();
+        explicit CoreObject(const CoreClass& coreClass);
+
+        static void* operator new(size_t size);
+        static void operator delete(void* memory, size_t size) noexcept;
+
+        const MemberCache& findMember(const std::string_view name, MemberCache& cache) const
+        {
+            if (cache.shape != m_shape) {
+                resolveMember(name, cache);
+            }
+
+            return cache;
+        }
+
+        Symbol& getField(const size_t index)
+        {
+            return m_members[index];
+        }
 
     protected:
         template<typename T>
-        T& get(const std::string& name)
+        T get(const std::string& name)
         {
-            return std::get<T>(m_members[name].getData());
+            T result{};
+            m_members[findField(name)].visit([&result](auto && arg) {
+                if constexpr (std::is_same_v<std::decay_t<decltype(arg)>, T>) {
+                    result = arg;
+                }
+                else {
+                    throw std::runtime_error{ "Wrong member type" };
+                }
+            });
+            return result;
         }
 
         template<typename T>
         bool checkType(const std::string& name)
         {
-            return std::holds_alternative<T>(m_members[name].getData());
+            auto result = false;
+            m_members[findField(name)].visit([&result](auto && arg) {
+                result = std::is_same_v<std::decay_t<decltype(arg)>, T>;
+            });
+            return result;
         }
 
+        // Members are registered before the object is used, references to them stay valid
         template<typename T>
         void registerMember(const std::string& name, T&& data)
         {
-            m_members.try_emplace(name, data, Symbol::ValueCategory::Lvalue);
+            if (m_shape->find(name).has_value()) {
+                return;
+            }
+
+            m_shape = m_shape->add(name);
+            m_members.emplace_back(data, Symbol::ValueCategory::Lvalue);
         }
 
-        virtual ~CoreObject() = default;
+        ~CoreObject() override;
+
+        // Symbols which can hold other objects, fields of subclasses included
+        virtual void collectSymbols(std::vector<Symbol*>& symbols);
 
     private:
-        std::unordered_map<std::string, Symbol> m_members;
+        void resolveMember(std::string_view name, MemberCache& cache) const;
+        size_t findField(const std::string& name) const;
+
+        friend class CoreHeap;
+
+        const CoreObjectShape* m_shape = CoreObjectShape::getEmpty();
+        std::pmr::vector<Symbol> m_members;
+
+        // Objects of the same generation, newest first
+        CoreObject* m_previousObject = nullptr;
+        CoreObject* m_nextObject = nullptr;
+        bool m_old = false;
+
+        // State of the collection
+        size_t m_internalReferences = 0;
+        bool m_alive = false;
     };
 }
@@ -1,50 +1,177 @@
 #pragma once
 
 #include <deque>
-#include <stack>
 #include <functional>
+#include <memory_resource>
 #include <unordered_map>
 #include <unordered_set>
 
+#include "Stack.hpp"
 #include "Symbol.hpp"
+#include "CoreObject.hpp"
+#include "MemoryAccount.hpp"
 
 namespace app
 {
+    class Profiler;
+
     class Evaluator final
     {
-        using StackItem = std::variant<Symbol, std::string_view>;
+        using StackItem = std::variant<Symbol, std::string_view, LocalSlot, GlobalSlot>;
+        using Block = std::pmr::unordered_map<std::string_view, Symbol>;
+
+        struct Frame
+        {
+            size_t base;        // first local slot
+            size_t blockBase;   // first scope block
+        };
 
     public:
+        enum class Status
+        {
+            Yielded,    // instruction budget ran out, the next run continues from there
+            Finished,
+            Error       // see getError
+        };
+
         explicit Evaluator(bool loggingEnabled);
+        ~Evaluator();
 
-        void eval(const std::vector<ByteCodeItem>& byteCode);
+        Evaluator(const Evaluator&) = delete;
+        Evaluator& operator=(const Evaluator&) = delete;
+
+        // Verified bytecode runs without stack checks, see Verifier
+        void eval(const std::vector<ByteCodeItem>& byteCode, bool verified);
+
+        // Evaluates the bytecode in slices. It must stay alive until the evaluation finishes.
+        // The budget is checked at jumps and calls, so a slice may run a few instructions over it
+        void load(const std::vector<ByteCodeItem>& byteCode, bool verified);
+        Status run(size_t maxInstructions);
+        const std::string& getError() const;
 
         void push(const Symbol& symbol);
+        void push(Symbol&& symbol);
+        Symbol pop();
+        size_t getStackSize() const;
+
+        size_t getInstructionCount() const;
+
+        void setProfiler(Profiler* profiler);
+
+        // Maximum size of the value, pointer, block and call stacks
+        void setStackLimit(size_t limit);
+
+        // Memory allocated by the evaluation, see MemoryAccount
+        MemoryAccount& getMemory();
 
         template<typename T>
         void registerVariable(std::string_view name, T&& value)
         {
-            m_blocks.back().try_emplace(name, value, Symbol::ValueCategory::Lvalue);
+            m_blocks.top().try_emplace(name, value, Symbol::ValueCategory::Lvalue);
         }
 
+        void declareVariable(std::string_view name);
+        void declareVariable(LocalSlot slot);
+        void declareVariable(GlobalSlot slot);
+        void declareFunction(std::string_view name, Pointer address);
+        void declareFunction(GlobalSlot slot, Pointer address);
+
         Symbol& findVariable(std::string_view name);
+        Symbol& findVariable(LocalSlot slot);
+        Symbol& findVariable(GlobalSlot slot);
         bool hasVariable(std::string_view name) const;
 
+        void pushBlock();
+        void popBlock();
+
+        // Arguments are pushed right after the locals of the caller and become the first
+        // slots of the callee frame, parameters are bound to them in place
+        void pushFunctionArgument(const Symbol& argument);
+        void pushFunctionArgument(Symbol&& argument);
+        void pushFrame(size_t argumentCount);
+        void popFrame();
+
+        // Tail calls move the pending arguments over the current frame instead of pushing a new one.
+        // Arguments referencing a variable are copied for parameters taken by value. If a parameter
+        // taken by reference needs a variable of the frame, the frame is kept and false is returned
+        template<typename F>
+        bool reuseFrame(size_t argumentCount, F&& isValueParameter)
+        {
+            if (m_frames.empty() || argumentCount > m_locals.size() - m_frameBase) {
+                return false;
+            }
+
+            const auto argumentsBegin = m_locals.size() - argumentCount;
+            for (size_t i = 0; i < argumentCount; ++i) {
+                auto& argument = m_locals[argumentsBegin + i];
+                if (argument.getType() != Symbol::Type::Reference) {
+                    continue;
+                }
+
+                if (isValueParameter(i)) {
+                    argument = Symbol{ argument.unref(), Symbol::ValueCategory::Lvalue };
+                }
+                else if (isFrameVariable(argument.unref(), argumentsBegin)) {
+                    return false;
+                }
+            }
+
+            replaceFrame(argumentCount);
+            return true;
+        }
+
+        void declareArgument(std::string_view name, bool isReference);
+        void declareArgument(LocalSlot slot, bool isReference);
+        void declareArgument(GlobalSlot slot, bool isReference);
+
+        // Methods which are called right away get their object from the evaluator,
+        // otherwise the member access binds the method to a new function
+        Symbol getMember(const CoreObjectPtr& object, std::string_view name, MemberCache& cache, bool isCalled);
+        void setMethodObject(CoreObjectPtr object);
+        CoreObjectPtr takeMethodObject();
+
+        // Core functions read the last pushed arguments, which are dropped afterwards
+        void beginFunctionArguments(size_t argumentCount);
         Symbol popFunctionArgument();
         bool hasFunctionArguments() const;
         size_t getFunctionArgumentCount() const;
+        void clearFunctionArguments();
 
     private:
-        void handleDecl(OpCode op);
-        void handleAssign(OpCode op);
-        void handleDeref();
-        void handleStructRef();
-        void handlePop();
-        void handleUnaryOperator(OpCode op);
-        void handleBinaryOperator(OpCode op);
-        void handleControl(OpCode op);
-        void handleArguments(OpCode op);
-        void handleBlocks(OpCode op);
+        template<bool Checked> Status execute();
+
+        template<bool Checked> void handleDecl(OpCode op);
+        template<bool Checked> void handleAssign(OpCode op);
+        template<bool Checked> void handleDeref();
+        template<bool Checked> void handleStructRef(bool isCalled);
+        template<bool Checked> void handlePop();
+        template<bool Checked> void handleUnaryOperator(OpCode op);
+        template<bool Checked> void handleBinaryOperator(OpCode op, uint8_t& code);
+        template<bool Checked, OpCode Op> void handleNumberOperator(uint8_t& code);
+        template<bool Checked> void handleStringConcatenation(uint8_t& code);
+        template<bool Checked> void handleControl(OpCode op);
+        template<bool Checked> void handleCompareJump(uint8_t& code);
+        template<bool Checked> void handleNumberCompareJump(uint8_t& code);
+        template<bool Checked> void handleArguments(OpCode op);
+        template<bool Checked> void handleBlocks(OpCode op);
+
+        template<bool Checked> void pushMember(bool isCalled);
+        size_t readArgumentCount(const StackItem& item) const;
+
+        // Quickened instruction which failed its type guard goes back to the generic one
+        void dequicken(uint8_t& code, OpCode op);
+        Symbol& resolveSymbol(StackItem& item);
+        void jumpIf(bool value);
+
+        void releaseBlock();
+        Symbol* findNamed(std::string_view name);
+        Symbol& declareNamed(std::string_view name, Symbol value);
+
+        Symbol& nextArgument();
+        bool tailCall(size_t argumentCount);
+        bool isFrameVariable(const Symbol& symbol, size_t end) const;
+        void replaceFrame(size_t argumentCount);
+        void bindArgument(Symbol& variable, Symbol& argument, bool isReference);
 
         template<typename F>
         void visitSymbol(F&& visitor, StackItem& item)
@@ -52,7 +179,7 @@ namespace app
             std::visit([this, &visitor](auto&& arg) {
                 using T = std::decay_t<decltype(arg)>;
 
-                if constexpr (std::is_same_v<T, std::string_view>) {
+                if constexpr (details::is_any_of_v<T, std::string_view, LocalSlot, GlobalSlot>) {
                     visitor(findVariable(arg));
                 }
                 else {
@@ -71,16 +198,59 @@ namespace app
             }, itemLeft);
         }
 
+        void trace(const ByteCodeItem& item, size_t step);
         void printState(bool showVariables);
 
+        // Declared first, everything charged to it is released before it
+        MemoryAccount m_memory;
+
         bool m_loggingEnabled;
 
+        // Loaded bytecode and its dispatch codes, which are quickened in place
+        const std::vector<ByteCodeItem>* m_byteCode = nullptr;
+        std::vector<uint8_t> m_codes;
+        bool m_verified = false;
+        Status m_status = Status::Finished;
+        std::string m_error;
+
         size_t m_position = 0;
+        size_t m_instructionCount = 0;
+        size_t m_instructionLimit = 0;  // run yields at the first jump or call past it
+        size_t m_traceStep = 0;
+
+        Profiler* m_profiler = nullptr;
+
+        Stack<Block> m_blocks;
+
+        // Storage of deleted blocks and their variables, reused by the following blocks
+        std::pmr::vector<Block> m_freeBlocks;
+        std::vector<Block::node_type> m_freeVariables;
+
+        // Slots of resolved variables. Deques keep references to slots valid while frames grow
+        std::pmr::deque<Symbol> m_globals;
+        std::pmr::deque<Symbol> m_locals;
+        Stack<Frame> m_frames;
+        size_t m_frameBase = 0;
+        size_t m_blockBase = 0;         // first scope block of the current frame, 0 at the top level
+        size_t m_argumentCount = 0;     // arguments passed to the current frame
+        size_t m_parameterIndex = 0;    // next argument to bind
+
+        // Arguments of the running core function, read in the order they were pushed
+        size_t m_argumentsStart = 0;
+        size_t m_argumentsBegin = 0;
+        size_t m_argumentsEnd = 0;
+
+        Stack<StackItem> m_stack;
+        Stack<Pointer> m_pointerStack;
+
+        // Member lookups of STRUCTREF and CALL_MEMBER, one per bytecode item
+        std::vector<MemberCache> m_memberCaches;
+        CoreObjectPtr m_methodObject;
 
-        std::deque<std::unordered_map<std::string_view, Symbol>> m_blocks;
+        // Instructions which are not quickened anymore, one per bytecode item
+        std::vector<bool> m_dequickened;
 
-        std::deque<StackItem> m_stack;
-        std::deque<Symbol> m_argumentsStack;
-        std::stack<Pointer> m_pointerStack;
+        // Interned string literals, one per bytecode item
+        std::vector<Value> m_strings;
     };
 }
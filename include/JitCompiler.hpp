@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "RegisterCode.hpp"
+
+namespace app
+{
+    // Functions of the interpreter called from the native code. They never throw,
+    // errors are kept by the interpreter and reported with JitFunction::ERROR
+    struct JitRuntime final
+    {
+        void* context;
+        size_t* instructionCount;
+
+        // Executes the instruction and returns the next position
+        size_t (*step)(void* context, size_t position);
+        // Returns 1 if the IF instruction jumps to its first address, 0 otherwise
+        size_t (*condition)(void* context, size_t position);
+        // Registers of the current frame
+        Symbol* (*registers)(void* context);
+        // Local or global slot, null if it is not declared yet
+        Symbol* (*variable)(void* context, size_t kind, size_t index);
+    };
+
+    // Native code of a function or a loop. It starts at one of its entries: the first
+    // instruction, a loop header or right after a call. Runs until it returns, calls
+    // a script function or leaves the code, then returns the position where the
+    // interpreter continues
+    class JitFunction final
+    {
+    public:
+        static constexpr size_t NOT_ENTERED = SIZE_MAX;
+        static constexpr size_t ERROR = SIZE_MAX - 1;
+
+        JitFunction(void* code, size_t size, size_t begin, size_t end, std::vector<size_t> entries);
+        ~JitFunction();
+
+        JitFunction(const JitFunction&) = delete;
+        JitFunction& operator=(const JitFunction&) = delete;
+
+        size_t run(const size_t position) const
+        {
+            return reinterpret_cast<size_t(*)(size_t)>(m_code)(position);
+        }
+
+        size_t getBegin() const;
+        size_t getEnd() const;
+        const std::vector<size_t>& getEntries() const;
+
+    private:
+        void* m_code;
+        size_t m_size;
+
+        size_t m_begin;
+        size_t m_end;
+        std::vector<size_t> m_entries;
+    };
+
+    // Baseline compiler of register code to x86-64. Every instruction is translated
+    // by its own template: number arithmetic, comparisons and branches are inlined
+    // behind type guards, everything else and failed guards call the interpreter.
+    // Comparisons followed by IF of their result branch directly
+    class JitCompiler final
+    {
+    public:
+        explicit JitCompiler(const JitRuntime& runtime);
+
+        static bool isSupported();
+
+        // Compiles instructions [begin, end) of a function or a loop, returns null if it can't
+        std::unique_ptr<JitFunction> compile(const RegisterProgram& program, size_t begin, size_t end) const;
+
+    private:
+        JitRuntime m_runtime;
+    };
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+namespace app
+{
+    // Live and peak bytes allocated on behalf of one evaluator, with an optional quota.
+    // Containers of the evaluator allocate through its resources, strings and core objects
+    // are charged to the account which is current on their thread when they are created.
+    // Values charged to an account must not outlive it
+    class MemoryAccount final
+    {
+    public:
+        enum class Category
+        {
+            Strings,
+            Symbols,    // value stacks, call stacks and variable slots
+            Scopes,
+            Objects,
+            Count
+        };
+
+        static constexpr size_t NO_QUOTA = SIZE_MAX;
+
+        // Makes the account current on this thread until the scope ends
+        class Scope final
+        {
+        public:
+            explicit Scope(MemoryAccount* account);
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            MemoryAccount* m_previous;
+        };
+
+        MemoryAccount();
+
+        MemoryAccount(const MemoryAccount&) = delete;
+        MemoryAccount& operator=(const MemoryAccount&) = delete;
+
+        static MemoryAccount* getCurrent();
+        static const char* getName(Category category);
+
+        std::pmr::memory_resource* getResource(Category category);
+
+        // Throws if the live size would exceed the quota
+        void charge(Category category, size_t size);
+        void discharge(Category category, size_t size) noexcept;
+
+        void setQuota(size_t quota);
+        size_t getQuota() const;
+
+        size_t getLiveSize() const;
+        size_t getPeakSize() const;
+        size_t getLiveSize(Category category) const;
+        size_t getPeakSize(Category category) const;
+
+    private:
+        static constexpr auto CATEGORY_COUNT = static_cast<size_t>(Category::Count);
+
+        // Charges the category of its account and allocates from the default resource
+        class Resource final : public std::pmr::memory_resource
+        {
+        public:
+            MemoryAccount* account = nullptr;
+            Category category = Category::Strings;
+
+        private:
+            void* do_allocate(size_t size, size_t alignment) override;
+            void do_deallocate(void* memory, size_t size, size_t alignment) override;
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+        };
+
+        Resource m_resources[CATEGORY_COUNT];
+
+        size_t m_quota = NO_QUOTA;
+        size_t m_liveSize = 0;
+        size_t m_peakSize = 0;
+        size_t m_liveSizes[CATEGORY_COUNT] = {};
+        size_t m_peakSizes[CATEGORY_COUNT] = {};
+    };
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+
+#include "ByteCode.hpp"
+
+namespace app
+{
+    class Optimizer final
+    {
+    public:
+        std::vector<ByteCodeItem> optimize(const std::vector<ByteCodeItem>& byteCode);
+
+    private:
+        bool foldConstants();
+        bool propagateConstants();
+        void fuseInstructions();
+        void eliminateTailCalls();
+
+        std::vector<ByteCodeItem> m_byteCode;
+    };
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <unordered_map>
+
+#include "ByteCode.hpp"
+
+namespace app
+{
+    // Counts sequences of executed bytecode items. Frequent sequences
+    // are candidates for new superinstructions
+    class Profiler final
+    {
+    public:
+        static constexpr size_t MIN_SEQUENCE_LENGTH = 2;
+        static constexpr size_t MAX_SEQUENCE_LENGTH = 5;
+
+        void record(const ByteCodeItem& item);
+
+        // Prints the most frequent sequences of each length
+        void print(size_t count) const;
+
+    private:
+        using Key = uint64_t;
+
+        std::array<uint8_t, MAX_SEQUENCE_LENGTH> m_history{};
+        size_t m_historySize = 0;
+        size_t m_itemCount = 0;
+
+        std::array<std::unordered_map<Key, size_t>, MAX_SEQUENCE_LENGTH + 1> m_sequences;
+    };
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace app
+{
+    // Intrusive reference count of core objects and functions. Counting is not atomic,
+    // objects used by several threads must be shared with shareAcrossThreads before
+    // another thread can see them
+    class RefCounted
+    {
+    public:
+        RefCounted(const RefCounted&) = delete;
+        RefCounted& operator=(const RefCounted&) = delete;
+
+        void retain() const noexcept
+        {
+            if (m_threadShared) {
+                m_references.fetch_add(1, std::memory_order_relaxed);
+            }
+            else {
+                m_references.store(m_references.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+        }
+
+        // Deletes the object when the last reference is released
+        void release() const noexcept
+        {
+            if (releaseWithoutDelete()) {
+                delete this;
+            }
+        }
+
+        // Returns true when the last reference is released, the caller deletes the object
+        bool releaseWithoutDelete() const noexcept
+        {
+            size_t references = 0;
+            if (m_threadShared) {
+                references = m_references.fetch_sub(1, std::memory_order_acq_rel) - 1;
+            }
+            else {
+                references = m_references.load(std::memory_order_relaxed) - 1;
+                m_references.store(references, std::memory_order_relaxed);
+            }
+
+            return references == 0;
+        }
+
+        size_t getReferenceCount() const noexcept
+        {
+            return m_references.load(std::memory_order_relaxed);
+        }
+
+        void shareAcrossThreads() noexcept
+        {
+            m_threadShared = true;
+        }
+
+    protected:
+        RefCounted() = default;
+        virtual ~RefCounted() = default;
+
+    private:
+        mutable std::atomic<size_t> m_references{ 0 };
+        bool m_threadShared = false;
+    };
+
+    // Owning pointer to a reference counted object. The object type may be incomplete,
+    // counting goes through retainReference and releaseReference found by ADL
+    template<typename T>
+    class Ref final
+    {
+    public:
+        Ref() noexcept = default;
+
+        Ref(std::nullptr_t) noexcept
+        {
+        }
+
+        explicit Ref(T* object) noexcept :
+            m_object(object)
+        {
+            if (m_object != nullptr) {
+                retainReference(m_object);
+            }
+        }
+
+        Ref(const Ref& ref) noexcept :
+            Ref(ref.m_object)
+        {
+        }
+
+        Ref(Ref&& ref) noexcept :
+            m_object(std::exchange(ref.m_object, nullptr))
+        {
+        }
+
+        template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+        Ref(const Ref<U>& ref) noexcept :
+            Ref(ref.get())
+        {
+        }
+
+        ~Ref()
+        {
+            if (m_object != nullptr) {
+                releaseReference(m_object);
+            }
+        }
+
+        Ref& operator=(Ref ref) noexcept
+        {
+            std::swap(m_object, ref.m_object);
+            return *this;
+        }
+
+        T* get() const noexcept
+        {
+            return m_object;
+        }
+
+        T& operator*() const noexcept
+        {
+            return *m_object;
+        }
+
+        T* operator->() const noexcept
+        {
+            return m_object;
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return m_object != nullptr;
+        }
+
+        friend bool operator==(const Ref& left, const Ref& right) noexcept
+        {
+            return left.m_object == right.m_object;
+        }
+
+        friend bool operator!=(const Ref& left, const Ref& right) noexcept
+        {
+            return left.m_object != right.m_object;
+        }
+
+    private:
+        T* m_object = nullptr;
+    };
+
+    template<typename T, typename... Args>
+    Ref<T> makeRef(Args&&... args)
+    {
+        return Ref<T>{ new T(std::forward<Args>(args)...) };
+    }
+}
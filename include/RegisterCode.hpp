@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+#include "Symbol.hpp"
+
+namespace app
+{
+    // Three-address form of the bytecode. Uses the same OpCode set, but
+    // operands are encoded into the instruction instead of being pushed
+    // to the stack:
+    //
+    //  DECLVAR     A(var/slot)
+    //  DECLARG     A(var/slot) := next argument, DECLARGREF binds a reference
+    //  DECLFUN     A(var/slot), B(address)
+    //  ASSIGN      A(reg/var/slot) := B
+    //  ASSIGNREF   A(reg/var/slot) := &B
+    //  DEREF       A := copy of B
+    //  STRUCTREF   A := B.C(var)
+    //  NOT, UNM    A := op B
+    //  ADD..GE     A := B op C
+    //  IF          A ? jump B(address) : jump C(address)
+    //  JMP         jump A(address)
+    //  CALL        A := B(...), C(number) arguments
+    //  RET         return A
+    //  PUSHARG     push A to the callee frame
+    //  DEFBLOCK, DELBLOCK
+    //
+    // Result operand A can be empty if the value is not used, or a variable
+    // if the result is immediately assigned to it. Slots are variables
+    // resolved at compile time (local or global).
+
+    struct RegisterOperand final
+    {
+        enum class Kind
+        {
+            None,
+            Register,
+            Constant,
+            Variable,
+            Local,
+            Global,
+            Address,
+        };
+
+        Kind kind = Kind::None;
+        size_t index = 0;
+        size_t name = 0;    // slots: index of the variable name in names
+    };
+
+    struct RegisterInstruction final
+    {
+        OpCode op;
+        RegisterOperand a;
+        RegisterOperand b;
+        RegisterOperand c;
+    };
+
+    struct RegisterProgram final
+    {
+        std::vector<RegisterInstruction> instructions;
+        std::vector<Symbol> constants;
+        std::vector<std::string_view> names;
+        size_t registerCount = 0;
+    };
+
+    void print(const RegisterProgram& program, const RegisterInstruction& instruction);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "RegisterCode.hpp"
+
+namespace app
+{
+    class RegisterCompiler final
+    {
+    public:
+        RegisterProgram compile(const std::vector<ByteCodeItem>& byteCode);
+
+    private:
+        RegisterOperand pop();
+        Pointer popPointer();
+        void push(const RegisterOperand& operand);
+        RegisterOperand pushRegister();
+
+        RegisterOperand createConstant(const ByteCodeItem& item);
+        RegisterOperand createVariable(std::string_view name);
+        size_t addName(std::string_view name);
+
+        void emit(OpCode op, const RegisterOperand& a,
+            const RegisterOperand& b = {}, const RegisterOperand& c = {});
+
+        bool isReturnValue(size_t position) const;
+
+        const std::vector<ByteCodeItem>* m_byteCode = nullptr;
+
+        RegisterProgram m_program;
+
+        std::unordered_map<std::string_view, size_t> m_nameIndices;
+
+        std::vector<RegisterOperand> m_stack;
+        std::vector<Pointer> m_pointerStack;
+    };
+}
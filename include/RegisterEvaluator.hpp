@@ -0,0 +1,91 @@
+#pragma once
+
+#include <exception>
+#include <memory>
+
+#include "Evaluator.hpp"
+#include "JitCompiler.hpp"
+#include "RegisterCode.hpp"
+
+namespace app
+{
+    // Executes register code. Variables, scope blocks, function arguments
+    // and core functions are shared with the stack evaluator.
+    // Functions called JIT_THRESHOLD times are compiled to native code, loops
+    // which jump back OSR_THRESHOLD times are compiled and entered on the next iteration
+    class RegisterEvaluator final
+    {
+        struct Frame
+        {
+            size_t returnPosition;
+            size_t base;
+            RegisterOperand result;
+        };
+
+    public:
+        static constexpr size_t JIT_THRESHOLD = 100;
+        static constexpr size_t OSR_THRESHOLD = 1000;
+
+        RegisterEvaluator(Evaluator& evaluator, bool loggingEnabled, bool jitEnabled);
+
+        void eval(const RegisterProgram& program);
+
+        size_t getInstructionCount() const;
+
+        // Execution tier of the top level code and of each function
+        void printTiers() const;
+
+    private:
+        void execute(const RegisterInstruction& instruction);
+        void countCall(size_t address);
+        void countBackEdge(size_t header, size_t end);
+        void compile(size_t begin, size_t end);
+
+        void handleDecl(const RegisterInstruction& instruction);
+        void handleAssign(const RegisterInstruction& instruction);
+        void handleDeref(const RegisterInstruction& instruction);
+        void handleStructRef(const RegisterInstruction& instruction);
+        void handleUnaryOperator(const RegisterInstruction& instruction);
+        void handleBinaryOperator(const RegisterInstruction& instruction);
+        void handleControl(const RegisterInstruction& instruction);
+        bool tailCall(const RegisterInstruction& instruction);
+        void handleArguments(const RegisterInstruction& instruction);
+
+        const Symbol& read(const RegisterOperand& operand);
+        Symbol& access(const RegisterOperand& operand);
+        void write(const RegisterOperand& operand, Symbol value);
+        bool readCondition(const RegisterOperand& operand);
+        LocalSlot toLocal(const RegisterOperand& operand) const;
+        GlobalSlot toGlobal(const RegisterOperand& operand) const;
+
+        // JitRuntime functions
+        static size_t jitStep(void* context, size_t position);
+        static size_t jitCondition(void* context, size_t position);
+        static Symbol* jitRegisters(void* context);
+        static Symbol* jitVariable(void* context, size_t kind, size_t index);
+
+        Evaluator& m_evaluator;
+        bool m_loggingEnabled;
+
+        const RegisterProgram* m_program = nullptr;
+
+        size_t m_position = 0;
+        size_t m_instructionCount = 0;
+
+        size_t m_base = 0;
+        std::vector<Symbol> m_registers;
+        std::vector<Frame> m_frames;
+
+        // Member lookups of STRUCTREF, one per instruction
+        std::vector<MemberCache> m_memberCaches;
+
+        // Native code is null if the JIT is disabled or not supported
+        std::unique_ptr<JitCompiler> m_jitCompiler;
+        std::vector<std::unique_ptr<JitFunction>> m_jitFunctions;
+        std::vector<const JitFunction*> m_nativeCode;   // native code entered at each instruction
+        std::vector<size_t> m_functionEnds;             // end of each function by its address
+        std::vector<size_t> m_callCounts;               // calls of each function by its address
+        std::vector<size_t> m_loopCounts;               // back edges of each loop by its header
+        std::exception_ptr m_jitError;
+    };
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Evaluator.hpp"
+#include "ThreadPool.hpp"
+
+namespace app
+{
+    // Script compiled once and shared by all of its evaluations, it is not changed after
+    // compile. Names in the bytecode view the text
+    struct Program
+    {
+        std::string name;
+        std::string text;
+        std::vector<ByteCodeItem> byteCode;
+        bool verified = false;
+    };
+
+    // Runs scripts on a pool of threads, every evaluation with its own Evaluator and
+    // StandardLibrary. An evaluation stays on the thread it started on, its values
+    // are counted without atomics and its objects live in the heap of that thread
+    class ScriptHost final
+    {
+    public:
+        struct Result
+        {
+            Evaluator::Status status = Evaluator::Status::Yielded;
+            std::string error;
+            std::string output;
+            size_t instructionCount = 0;
+            size_t peakMemory = 0;
+        };
+
+        explicit ScriptHost(size_t threadCount);
+
+        // Throws if the script can't be parsed
+        static std::unique_ptr<const Program> compile(std::string name, std::string text, bool optimize);
+
+        // Program and result must stay alive until wait returns. Scripts can't read input
+        void submit(const Program& program, Result& result);
+        void wait();
+
+        // Evaluates on the calling thread
+        Result run(const Program& program) const;
+
+        void setStackLimit(size_t limit);
+        void setMemoryQuota(size_t quota);
+
+        const ThreadPool& getPool() const;
+
+    private:
+        size_t m_stackLimit = Stack<size_t>::DEFAULT_LIMIT;
+        size_t m_memoryQuota = MemoryAccount::NO_QUOTA;
+
+        // Declared last, remaining evaluations finish before the settings are destroyed
+        ThreadPool m_pool;
+    };
+}
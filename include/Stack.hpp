@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <stdexcept>
+#include <memory_resource>
+
+namespace app
+{
+    // Contiguous stack with preallocated storage. Grows until the size limit is reached
+    template<typename T>
+    class Stack final
+    {
+    public:
+        static constexpr size_t DEFAULT_LIMIT = 1000000;
+
+        explicit Stack(const size_t capacity, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) :
+            m_items(resource),
+            m_limit(DEFAULT_LIMIT)
+        {
+            m_items.reserve(capacity);
+        }
+
+        void push(const T& item)
+        {
+            emplace(item);
+        }
+
+        template<typename... Args>
+        T& emplace(Args&&... args)
+        {
+            if (m_items.size() >= m_limit) {
+                throw std::runtime_error{ "Stack overflow" };
+            }
+            return m_items.emplace_back(std::forward<Args>(args)...);
+        }
+
+        void pop()
+        {
+            m_items.pop_back();
+        }
+
+        T& top()
+        {
+            return m_items.back();
+        }
+
+        const T& top() const
+        {
+            return m_items.back();
+        }
+
+        T& operator[](const size_t index)
+        {
+            return m_items[index];
+        }
+
+        const T& operator[](const size_t index) const
+        {
+            return m_items[index];
+        }
+
+        size_t size() const
+        {
+            return m_items.size();
+        }
+
+        bool empty() const
+        {
+            return m_items.empty();
+        }
+
+        void clear()
+        {
+            m_items.clear();
+        }
+
+        void setLimit(const size_t limit)
+        {
+            m_limit = limit;
+        }
+
+        auto begin() { return m_items.begin(); }
+        auto end() { return m_items.end(); }
+        auto begin() const { return m_items.begin(); }
+        auto end() const { return m_items.end(); }
+        auto rbegin() { return m_items.rbegin(); }
+        auto rend() { return m_items.rend(); }
+        auto rbegin() const { return m_items.rbegin(); }
+        auto rend() const { return m_items.rend(); }
+
+    private:
+        std::pmr::vector<T> m_items;
+        size_t m_limit;
+    };
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <iostream>
+
 #include "CoreObject.hpp"
 
 namespace app
@@ -7,9 +9,7 @@ namespace app
     class StandardLibrary final : public CoreObject
     {
     public:
-        StandardLibrary();
-        
-    private:
-
+        // Scripts read lines from the input and print to the output, which must outlive the library
+        explicit StandardLibrary(std::istream& input = std::cin, std::ostream& output = std::cout);
     };
 }
@@ -1,50 +1,19 @@
 #pragma once
 
+#include <iosfwd>
 #include <memory>
 #include <stdexcept>
 #include <unordered_map>
 
 #include "ByteCode.hpp"
+#include "Value.hpp"
 
 namespace app
 {
-    class CoreObject;
-    class CoreFunction;
-
-    using CoreObjectPtr = std::shared_ptr<CoreObject>;
-    using CoreFunctionPtr = std::shared_ptr<CoreFunction>;
-
-    struct ScriptFunction final
-    {
-        size_t address;
-    };
-
     class Symbol final
     {
     public:
-        using DataVariant = std::variant<
-            std::nullopt_t,
-            bool,
-            double,
-            std::string,
-            ScriptFunction,
-            CoreObjectPtr,
-            CoreFunctionPtr,
-            Symbol*>;
-
-        enum class Type
-        {
-            Null,
-            Bool,
-            Number,
-            String,
-            ScriptFunction,
-
-            CoreObject,
-            CoreFunction,
-
-            Reference
-        };
+        using Type = Value::Type;
 
         enum class ValueCategory {
             Lvalue,
@@ -56,10 +25,13 @@ namespace app
         Symbol(bool value, ValueCategory category);
         Symbol(double value, ValueCategory category);
         Symbol(const std::string& value, ValueCategory category);
+        Symbol(std::string&& value, ValueCategory category);
         Symbol(const ScriptFunction& value, ValueCategory category);
         Symbol(const CoreObjectPtr& value, ValueCategory category);
         Symbol(const CoreFunctionPtr& value, ValueCategory category);
+        Symbol(Value value, ValueCategory category);
         Symbol(const Symbol& symbol, ValueCategory category);
+        Symbol(Symbol&& symbol, ValueCategory category);
 
         explicit Symbol(Symbol* symbol);
 
@@ -89,33 +61,19 @@ namespace app
                 CoreObjectPtr,
                 CoreFunctionPtr>)
             {
-                symbol.m_data = value;
-                if constexpr (std::is_same_v<D, std::nullopt_t>) {
-                    symbol.m_type = Type::Null;
-                }
-                else if constexpr (std::is_same_v<D, bool>) {
-                    symbol.m_type = Type::Bool;
-                }
-                else if constexpr (std::is_same_v<D, double>) {
-                    symbol.m_type = Type::Number;
-                }
-                else if constexpr (std::is_same_v<D, std::string>) {
-                    symbol.m_type = Type::String;
-                }
-                else if constexpr (std::is_same_v<D, ScriptFunction>) {
-                    symbol.m_type = Type::ScriptFunction;
-                }
-                else if constexpr (std::is_same_v<D, CoreObjectPtr>) {
-                    symbol.m_type = Type::CoreObject;
-                }
-                else if constexpr (std::is_same_v<D, CoreFunctionPtr>) {
-                    symbol.m_type = Type::CoreFunction;
-                }
+                symbol.m_value = Value{ std::forward<T>(value) };
             }
             else if constexpr (std::is_same_v<D, Symbol>) {
                 auto& unreferencedValue = value.unref();
-                symbol.m_data = unreferencedValue.m_data;
-                symbol.m_type = unreferencedValue.m_type;
+
+                // Temporary values give away their data, referenced values are copied
+                if constexpr (!std::is_lvalue_reference_v<T>) {
+                    if (&unreferencedValue == &value) {
+                        symbol.m_value = std::move(value.m_value);
+                        return;
+                    }
+                }
+                symbol.m_value = unreferencedValue.m_value;
             }
             else {
                 throw std::runtime_error{ "Bad assign argument" };
@@ -130,21 +88,21 @@ namespace app
         template<typename Callable>
         void visit(Callable&& f) const
         {
-            std::visit(f, m_data);
+            m_value.visit(f);
         }
 
         void print() const;
+        void print(std::ostream& output) const;
 
         Type getType() const;
 
         void setValueCategory(ValueCategory category);
         ValueCategory getValueCategory() const;
 
-        DataVariant& getData();
+        const Value& getValue() const;
 
     protected:
-        Type m_type;
-        DataVariant m_data;
+        Value m_value;
 
         ValueCategory m_valueCategory;
     };
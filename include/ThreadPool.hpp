@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace app
+{
+    // Fixed set of workers, each with a queue of its own. Workers run their newest task
+    // first and steal the oldest tasks of other workers when their queue is empty
+    class ThreadPool final
+    {
+    public:
+        using Task = std::function<void()>;
+
+        explicit ThreadPool(size_t threadCount);
+
+        // Finishes the remaining tasks
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Tasks submitted by a worker go to its own queue, the others are spread over all queues.
+        // Tasks must not throw
+        void submit(Task task);
+
+        // Blocks until all submitted tasks are finished
+        void wait();
+
+        size_t getThreadCount() const;
+        size_t getStolenTaskCount() const;
+
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        void work(size_t index);
+        bool takeTask(size_t index, Task& task);
+
+        std::vector<std::unique_ptr<Queue>> m_queues;
+        std::vector<std::thread> m_threads;
+
+        // Counters of tasks, sleeping workers and wait are woken up when they change
+        std::mutex m_mutex;
+        std::condition_variable m_tasksQueued;
+        std::condition_variable m_tasksFinished;
+        size_t m_queuedTasks = 0;
+        size_t m_pendingTasks = 0;      // queued or running
+        bool m_stopping = false;
+
+        std::atomic<size_t> m_nextQueue{ 0 };
+        std::atomic<size_t> m_stolenTasks{ 0 };
+    };
+}
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <utility>
+
+#include "RefCounted.hpp"
+
+namespace app
+{
+    class Symbol;
+    class CoreObject;
+    class CoreFunction;
+
+    void retainReference(const CoreObject* object) noexcept;
+    void releaseReference(const CoreObject* object) noexcept;
+    void retainReference(const CoreFunction* function) noexcept;
+    void releaseReference(const CoreFunction* function) noexcept;
+
+    using CoreObjectPtr = Ref<CoreObject>;
+    using CoreFunctionPtr = Ref<CoreFunction>;
+
+    struct ScriptFunction final
+    {
+        size_t address;
+    };
+
+    // NaN-boxed 8-byte value. Numbers are stored unboxed, everything else lives in the 48-bit
+    // payload of negative NaNs: short strings inline, references as raw pointers, long strings
+    // as pointers to reference counted boxes, objects and functions as pointers to themselves.
+    // Long strings are immutable, concatenations of them are ropes which are flattened when
+    // their text is read
+    class Value final
+    {
+    public:
+        enum class Type
+        {
+            Null,
+            Bool,
+            Number,
+            String,
+            ScriptFunction,
+
+            CoreObject,
+            CoreFunction,
+
+            Reference
+        };
+
+        Value() noexcept :
+            m_bits(encode(Tag::Null, 0))
+        {
+        }
+
+        explicit Value(std::nullopt_t) noexcept :
+            m_bits(encode(Tag::Null, 0))
+        {
+        }
+
+        explicit Value(const bool value) noexcept :
+            m_bits(encode(Tag::Bool, value ? 1 : 0))
+        {
+        }
+
+        explicit Value(const double value) noexcept :
+            m_bits(value != value ? CANONICAL_NAN : toBits(value))
+        {
+        }
+
+        explicit Value(const ScriptFunction& value) noexcept :
+            m_bits(encode(Tag::ScriptFunction, value.address))
+        {
+        }
+
+        explicit Value(Symbol* value) noexcept :
+            m_bits(encode(Tag::Reference, reinterpret_cast<uintptr_t>(value)))
+        {
+        }
+
+        explicit Value(const std::string& value);
+        explicit Value(std::string&& value);
+        explicit Value(const CoreObjectPtr& value);
+        explicit Value(const CoreFunctionPtr& value);
+
+        Value(const Value& value) noexcept :
+            m_bits(value.m_bits)
+        {
+            retain();
+        }
+
+        Value(Value&& value) noexcept :
+            m_bits(value.m_bits)
+        {
+            value.m_bits = encode(Tag::Null, 0);
+        }
+
+        Value& operator=(const Value& value) noexcept
+        {
+            value.retain();
+            release();
+            m_bits = value.m_bits;
+            return *this;
+        }
+
+        Value& operator=(Value&& value) noexcept
+        {
+            if (this != &value) {
+                release();
+                m_bits = value.m_bits;
+                value.m_bits = encode(Tag::Null, 0);
+            }
+            return *this;
+        }
+
+        ~Value()
+        {
+            release();
+        }
+
+        Type getType() const;
+
+        bool isNumber() const
+        {
+            return m_bits <= MAX_NUMBER;
+        }
+
+        bool isString() const
+        {
+            return !isNumber() && (tag() == Tag::ShortString || tag() == Tag::String);
+        }
+
+        bool isReference() const
+        {
+            return (m_bits & ~PAYLOAD_MASK) == encode(Tag::Reference, 0);
+        }
+
+        double asNumber() const
+        {
+            double value;
+            std::memcpy(&value, &m_bits, sizeof(value));
+            return value;
+        }
+
+        Symbol* asReference() const
+        {
+            return reinterpret_cast<Symbol*>(payload());
+        }
+
+        // Object without taking a reference, null if the value is not an object
+        CoreObject* getCoreObject() const
+        {
+            return !isNumber() && tag() == Tag::CoreObject ? reinterpret_cast<CoreObject*>(payload()) : nullptr;
+        }
+
+        // Calls f with the same argument types as std::visit on the former symbol data variant
+        template<typename F>
+        decltype(auto) visit(F&& f) const
+        {
+            if (isNumber()) {
+                return f(asNumber());
+            }
+
+            switch (tag()) {
+            case Tag::Null:
+                return f(std::nullopt);
+            case Tag::Bool:
+                return f(payload() != 0);
+            case Tag::ScriptFunction:
+                return f(ScriptFunction{ static_cast<size_t>(payload()) });
+            case Tag::ShortString:
+            {
+                const auto text = shortString();
+                return f(text);
+            }
+            case Tag::Reference:
+                return f(asReference());
+            case Tag::String:
+                return f(flatString());
+            case Tag::CoreObject:
+            {
+                const CoreObjectPtr object{ getCoreObject() };
+                return f(object);
+            }
+            default:
+            {
+                const CoreFunctionPtr function{ reinterpret_cast<CoreFunction*>(payload()) };
+                return f(function);
+            }
+            }
+        }
+
+        template<typename F>
+        static decltype(auto) visit(F&& f, const Value& left, const Value& right)
+        {
+            return left.visit([&f, &right](auto && argLeft) {
+                return right.visit([&f, &argLeft](auto && argRight) {
+                    return f(argLeft, argRight);
+                });
+            });
+        }
+
+        // Shared box of the text, equal strings interned on the same thread are the same value
+        static Value intern(const std::string& text);
+
+        // Both values must be strings
+        static Value concatenate(const Value& left, const Value& right);
+        static bool equalStrings(const Value& left, const Value& right);
+
+        // Encoding used by the native code of JitCompiler
+        uint64_t getBits() const
+        {
+            return m_bits;
+        }
+
+        static constexpr uint64_t getMaxNumberBits()
+        {
+            return MAX_NUMBER;
+        }
+
+        static constexpr uint64_t getCanonicalNanBits()
+        {
+            return CANONICAL_NAN;
+        }
+
+        static constexpr uint64_t getBoolBits(const bool value)
+        {
+            return encode(Tag::Bool, value ? 1 : 0);
+        }
+
+        // Bits of references and reference counted values are not less than these
+        static constexpr uint64_t getMinReferenceBits()
+        {
+            return encode(Tag::Reference, 0);
+        }
+
+        static constexpr uint64_t getMinCountedBits()
+        {
+            return encode(Tag::String, 0);
+        }
+
+    private:
+        // Reference counted tags go last, so a single comparison tells if the value owns a reference
+        enum class Tag : uint64_t
+        {
+            Null = 1,
+            Bool,
+            ScriptFunction,
+            ShortString,
+            Reference,
+            String,
+            CoreObject,
+            CoreFunction
+        };
+
+        struct StringData;
+
+        struct BoxHeader
+        {
+            size_t references;
+        };
+
+        template<typename T>
+        struct Box final : BoxHeader
+        {
+            T value;
+        };
+
+        static constexpr uint64_t MAX_NUMBER = 0xFFF0000000000000;     // negative infinity
+        static constexpr uint64_t CANONICAL_NAN = 0x7FF8000000000000;
+        static constexpr uint64_t PAYLOAD_MASK = 0x0000FFFFFFFFFFFF;
+        static constexpr size_t SHORT_STRING_SIZE = 5;
+        static constexpr size_t MIN_ROPE_SIZE = 64;
+
+        static constexpr uint64_t encode(const Tag tag, const uint64_t payload)
+        {
+            return MAX_NUMBER | (static_cast<uint64_t>(tag) << 48) | (payload & PAYLOAD_MASK);
+        }
+
+        static uint64_t toBits(const double value)
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        Tag tag() const
+        {
+            return static_cast<Tag>((m_bits >> 48) & 0xF);
+        }
+
+        uint64_t payload() const
+        {
+            return m_bits & PAYLOAD_MASK;
+        }
+
+        bool isCounted() const
+        {
+            return m_bits >= encode(Tag::String, 0);
+        }
+
+        BoxHeader* header() const
+        {
+            return reinterpret_cast<BoxHeader*>(payload());
+        }
+
+        template<typename T>
+        Box<T>* box() const
+        {
+            return static_cast<Box<T>*>(header());
+        }
+
+        template<typename T>
+        void createBox(Tag tag, T&& value);
+
+        std::string shortString() const;
+        const std::string& flatString() const;
+        size_t stringHash() const;
+        size_t stringSize() const;
+        void appendString(std::string& text) const;
+
+        void retain() const
+        {
+            if (isCounted()) {
+                if (tag() == Tag::String) {
+                    ++header()->references;
+                }
+                else {
+                    retainCore();
+                }
+            }
+        }
+
+        void release()
+        {
+            if (isCounted()) {
+                if (tag() != Tag::String) {
+                    releaseCore();
+                }
+                else if (--header()->references == 0) {
+                    destroy();
+                }
+            }
+        }
+
+        void retainCore() const;
+        void releaseCore() const;
+        void destroy();
+        static void destroyString(Box<StringData>* root);
+
+        uint64_t m_bits;
+    };
+}
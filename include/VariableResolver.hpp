@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ByteCodeAnalysis.hpp"
+
+namespace app
+{
+    // Resolves variables to frame slots at compile time. Declarations of the top
+    // level code become global slots, declarations inside functions become
+    // slots of the function frame. Scope blocks without named variables are removed.
+    //
+    // Scoping is lexical: a name which is used inside a function without a local
+    // declaration refers to the top level declaration of the name. It keeps name
+    // lookup if there is no single such declaration.
+    class VariableResolver final
+    {
+        struct Declaration
+        {
+            std::string_view name;
+            size_t position;    // DECLVAR/DECLFUN
+            size_t nameItem;    // item with the declared name
+            size_t frame;       // 0 - top level code, otherwise function
+            size_t depth;       // block depth inside the frame
+            size_t block;       // DEFBLOCK position, NO_INDEX for the frame root
+            size_t slot;
+        };
+
+        struct Block
+        {
+            size_t definition;
+            std::vector<std::pair<std::string_view, size_t>> declarations;
+
+            bool operator==(const Block& other) const
+            {
+                return definition == other.definition && declarations == other.declarations;
+            }
+        };
+
+        using Environment = std::vector<Block>;
+
+    public:
+        // Returns false and leaves the code unchanged if it can't be resolved
+        bool resolve(std::vector<ByteCodeItem>& byteCode);
+
+    private:
+        bool findFrames();
+        bool analyzeFrame(size_t frame);
+        void assignSlots();
+        void rewrite();
+
+        bool isReference(size_t position) const;
+        const Declaration* findGlobal(std::string_view name) const;
+        bool isDynamic(std::string_view name) const;
+
+        std::vector<ByteCodeItem>* m_byteCode = nullptr;
+
+        std::vector<size_t> m_frameEntries;
+        std::vector<size_t> m_frameOf;
+        std::vector<size_t> m_nameItems;
+        std::vector<bytecode_analysis::Operand> m_operands;
+
+        std::vector<bool> m_visited;
+        std::vector<size_t> m_resolved;     // declaration of each reference
+        std::vector<size_t> m_removedBlock; // block deleted by each DELBLOCK
+
+        std::vector<Declaration> m_declarations;
+        std::unordered_map<size_t, size_t> m_declarationAt;                          // position -> declaration
+        std::unordered_map<std::string_view, std::vector<size_t>> m_declarationsByName; // name -> positions
+        std::unordered_set<std::string_view> m_freeNames;
+    };
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <optional>
+
+#include "ByteCode.hpp"
+
+namespace app
+{
+    // Proves that the value, pointer and scope block stacks never underflow, so the
+    // evaluator can skip its stack checks. Every function entry passed to DECLFUN is
+    // verified as a separate frame which starts with empty stacks and must return
+    // exactly one value. Type errors and function arguments are still checked at runtime
+    class Verifier final
+    {
+        struct State
+        {
+            size_t values;                  // lower bound of the value stack size
+            size_t blocks;                  // lower bound of the scope block count
+            std::vector<Pointer> pointers;  // exact pointer stack
+        };
+
+    public:
+        bool verify(const std::vector<ByteCodeItem>& byteCode);
+
+    private:
+        bool verifyFrame(Pointer entry, bool isFunction);
+        bool merge(size_t position, const State& state);
+
+        const std::vector<ByteCodeItem>* m_byteCode = nullptr;
+
+        std::vector<Pointer> m_functions;
+        std::vector<std::optional<State>> m_states;
+        std::vector<size_t> m_pending;
+    };
+}
@@ -0,0 +1,42 @@
+#include "Allocations.hpp"
+
+#include <new>
+#include <cstdlib>
+
+namespace details
+{
+    thread_local size_t allocationCount = 0;
+    thread_local size_t allocatedSize = 0;
+}
+
+size_t app::getAllocationCount()
+{
+    return details::allocationCount;
+}
+
+size_t app::getAllocatedSize()
+{
+    return details::allocatedSize;
+}
+
+// Replacements of the global allocation functions, array forms forward to these
+void* operator new(const size_t size)
+{
+    ++details::allocationCount;
+    details::allocatedSize += size;
+
+    if (auto* memory = std::malloc(size == 0 ? 1 : size); memory != nullptr) {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
@@ -55,12 +55,22 @@ std::string app::toString(const OpCode code)
         return "RET";
     case OpCode::PUSHARG:
         return "PUSHARG";
-    case OpCode::POPARG:
-        return "POPARG";
+    case OpCode::DECLARG:
+        return "DECLARG";
+    case OpCode::DECLARGREF:
+        return "DECLARGREF";
     case OpCode::DEFBLOCK:
         return "DEFBLOCK";
     case OpCode::DELBLOCK:
         return "DELBLOCK";
+    case OpCode::INCVAR:
+        return "INCVAR";
+    case OpCode::LT_JMP:
+        return "LT_JMP";
+    case OpCode::CALL_MEMBER:
+        return "CALL_MEMBER";
+    case OpCode::TAILCALL:
+        return "TAILCALL";
     default:
         return "Unknown";
     }
@@ -92,5 +102,69 @@ void app::print(const ByteCodeItem & item)
         else if constexpr (std::is_same_v<T, Pointer >) {
             printf("ptr: %zu", arg);
         }
+        else if constexpr (std::is_same_v<T, LocalSlot>) {
+            printf("local: %zu", static_cast<size_t>(arg.index));
+        }
+        else if constexpr (std::is_same_v<T, GlobalSlot>) {
+            printf("global: %zu", static_cast<size_t>(arg.index));
+        }
     }, item);
 }
+
+void app::removeItems(std::vector<ByteCodeItem>& byteCode, const std::vector<bool>& removed)
+{
+    std::vector<size_t> positions(byteCode.size() + 1, 0);
+
+    size_t position = 0;
+    for (size_t i = 0; i < byteCode.size(); ++i) {
+        positions[i] = position;
+        if (removed[i]) {
+            continue;
+        }
+
+        // Self move assignment would leave strings empty
+        if (position != i) {
+            byteCode[position] = std::move(byteCode[i]);
+        }
+        ++position;
+    }
+    positions[byteCode.size()] = position;
+
+    byteCode.erase(byteCode.begin() + static_cast<std::ptrdiff_t>(position), byteCode.end());
+
+    for (auto& item : byteCode) {
+        auto* pointer = std::get_if<Pointer>(&item);
+        if (pointer != nullptr) {
+            *pointer = positions[*pointer];
+        }
+    }
+}
+
+void app::insertItems(std::vector<ByteCodeItem>& byteCode, std::vector<std::pair<size_t, ByteCodeItem>> items)
+{
+    std::vector<size_t> positions(byteCode.size() + 1, 0);
+
+    std::vector<ByteCodeItem> result;
+    result.reserve(byteCode.size() + items.size());
+
+    size_t next = 0;
+    for (size_t i = 0; i <= byteCode.size(); ++i) {
+        for (; next < items.size() && items[next].first == i; ++next) {
+            result.push_back(std::move(items[next].second));
+        }
+
+        positions[i] = result.size();
+        if (i < byteCode.size()) {
+            result.push_back(std::move(byteCode[i]));
+        }
+    }
+
+    for (auto& item : result) {
+        auto* pointer = std::get_if<Pointer>(&item);
+        if (pointer != nullptr) {
+            *pointer = positions[*pointer];
+        }
+    }
+
+    byteCode = std::move(result);
+}
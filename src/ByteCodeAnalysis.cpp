@@ -0,0 +1,216 @@
+#include "ByteCodeAnalysis.hpp"
+
+#include <stack>
+#include <optional>
+
+using namespace app::bytecode_analysis;
+
+bool app::bytecode_analysis::pushesValue(const ByteCodeItem& item)
+{
+    if (std::holds_alternative<Pointer>(item)) {
+        return false;
+    }
+
+    const auto* op = std::get_if<OpCode>(&item);
+    if (op == nullptr) {
+        return true;
+    }
+
+    switch (*op) {
+    case OpCode::DEREF:
+    case OpCode::STRUCTREF:
+    case OpCode::NOT:
+    case OpCode::UNM:
+    case OpCode::CALL:
+    case OpCode::CALL_MEMBER:
+    case OpCode::TAILCALL:
+        return true;
+    default:
+        return isBinaryMathOp(*op) || isLogicOp(*op) || isComparisonOp(*op);
+    }
+}
+
+std::vector<bool> app::bytecode_analysis::findJumpTargets(const std::vector<ByteCodeItem>& byteCode)
+{
+    std::vector<bool> result(byteCode.size() + 1, false);
+    for (const auto& item : byteCode) {
+        const auto* pointer = std::get_if<Pointer>(&item);
+        if (pointer != nullptr && *pointer < result.size()) {
+            result[*pointer] = true;
+        }
+    }
+    return result;
+}
+
+std::vector<Operand> app::bytecode_analysis::analyzeOperands(const std::vector<ByteCodeItem>& byteCode)
+{
+    std::vector<Operand> result(byteCode.size());
+
+    const auto targets = findJumpTargets(byteCode);
+
+    // Only remembers which item produced each value
+    std::vector<size_t> stack;
+
+    const auto pop = [&result, &stack](const size_t consumer, const size_t slot) {
+        if (stack.empty()) {
+            return;
+        }
+
+        result[stack.back()] = Operand{ consumer, slot };
+        stack.pop_back();
+    };
+
+    for (size_t i = 0; i < byteCode.size(); ++i) {
+        if (targets[i]) {
+            stack.clear();
+        }
+
+        std::visit([i, &stack, &pop](auto && arg) {
+            using T = std::decay_t<decltype(arg)>;
+
+            if constexpr (std::is_same_v<T, Pointer>) {
+                return;
+            }
+            else if constexpr (std::is_same_v<T, OpCode>) {
+                switch (arg) {
+                case OpCode::DECLVAR:
+                case OpCode::DECLFUN:
+                case OpCode::DECLARG:
+                case OpCode::DECLARGREF:
+                case OpCode::POP:
+                case OpCode::IF:
+                case OpCode::PUSHARG:
+                    pop(i, 0);
+                    break;
+
+                case OpCode::ASSIGN:
+                case OpCode::ASSIGNREF:
+                case OpCode::INCVAR:
+                case OpCode::LT_JMP:
+                    pop(i, 0);
+                    pop(i, 1);
+                    break;
+
+                case OpCode::DEREF:
+                case OpCode::NOT:
+                case OpCode::UNM:
+                    pop(i, 0);
+                    stack.push_back(i);
+                    break;
+
+                case OpCode::CALL_MEMBER:
+                    pop(i, 0);
+                    pop(i, 1);
+                    pop(i, 2);
+                    stack.push_back(i);
+                    break;
+
+                default:
+                    if (arg == OpCode::STRUCTREF || arg == OpCode::CALL || arg == OpCode::TAILCALL ||
+                        isBinaryMathOp(arg) || isLogicOp(arg) || isComparisonOp(arg))
+                    {
+                        pop(i, 0);
+                        pop(i, 1);
+                        stack.push_back(i);
+                    }
+                    break;
+                }
+            }
+            else {
+                stack.push_back(i);
+            }
+        }, byteCode[i]);
+    }
+
+    return result;
+}
+
+std::vector<size_t> app::bytecode_analysis::analyzeBlockDepth(const std::vector<ByteCodeItem>& byteCode)
+{
+    std::vector<size_t> result(byteCode.size(), NO_INDEX);
+    std::vector<bool> visited(byteCode.size(), false);
+
+    const auto pointerAt = [&byteCode](const size_t position) -> std::optional<Pointer> {
+        if (position >= byteCode.size()) {
+            return std::nullopt;
+        }
+
+        const auto* pointer = std::get_if<Pointer>(&byteCode[position]);
+        if (pointer == nullptr) {
+            return std::nullopt;
+        }
+        return *pointer;
+    };
+
+    std::stack<std::pair<size_t, size_t>> pending;
+    pending.emplace(0, 0);
+
+    while (!pending.empty()) {
+        const auto[position, depth] = pending.top();
+        pending.pop();
+
+        if (position >= byteCode.size()) {
+            continue;
+        }
+
+        if (visited[position]) {
+            if (result[position] != depth) {
+                result[position] = NO_INDEX;
+            }
+            continue;
+        }
+
+        visited[position] = true;
+        result[position] = depth;
+
+        const auto* op = std::get_if<OpCode>(&byteCode[position]);
+        if (op == nullptr) {
+            pending.emplace(position + 1, depth);
+            continue;
+        }
+
+        switch (*op) {
+        case OpCode::DEFBLOCK:
+            pending.emplace(position + 1, depth + 1);
+            break;
+
+        case OpCode::DELBLOCK:
+            if (depth > 0) {
+                pending.emplace(position + 1, depth - 1);
+            }
+            break;
+
+        case OpCode::JMP:
+        {
+            const auto target = pointerAt(position - 1);
+            if (!target.has_value()) {
+                return std::vector<size_t>(byteCode.size(), NO_INDEX);
+            }
+            pending.emplace(*target, depth);
+            break;
+        }
+
+        case OpCode::IF:
+        case OpCode::LT_JMP:
+        {
+            const auto truePointer = pointerAt(position - 2);
+            const auto falsePointer = pointerAt(position - 1);
+            if (!truePointer.has_value() || !falsePointer.has_value()) {
+                return std::vector<size_t>(byteCode.size(), NO_INDEX);
+            }
+            pending.emplace(*truePointer, depth);
+            pending.emplace(*falsePointer, depth);
+            break;
+        }
+
+        case OpCode::RET:
+            break;
+
+        default:
+            pending.emplace(position + 1, depth);
+            break;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,33 @@
+#include "CoreClass.hpp"
+
+app::CoreClass::CoreClass(const std::vector<std::string>& fields,
+    const std::vector<std::pair<std::string, CoreMethod::Function>>& methods) :
+    m_root(this),
+    m_shape(&m_root)
+{
+    for (const auto& name : fields) {
+        m_shape = m_shape->add(name);
+    }
+
+    // Classes are shared by evaluators running on different threads
+    for (const auto& [name, function] : methods) {
+        auto method = makeRef<CoreMethod>(function);
+        method->shareAcrossThreads();
+        m_methods.try_emplace(name, method, Symbol::ValueCategory::Rvalue);
+    }
+}
+
+const app::CoreObjectShape* app::CoreClass::getShape() const
+{
+    return m_shape;
+}
+
+const app::Symbol* app::CoreClass::findMethod(const std::string& name) const
+{
+    const auto it = m_methods.find(name);
+    if (it == m_methods.end()) {
+        return nullptr;
+    }
+
+    return &it->second;
+}
@@ -0,0 +1,241 @@
+#include "CoreHeap.hpp"
+
+#include <algorithm>
+#include <new>
+
+#include "CoreObject.hpp"
+
+app::CoreHeap& app::CoreHeap::get()
+{
+    // Heaps with objects left when their thread exits are never destroyed,
+    // the objects may still be released during static destruction
+    struct Owner
+    {
+        CoreHeap* heap = new CoreHeap{};
+
+        ~Owner()
+        {
+#ifndef USL_NO_CYCLE_COLLECTOR
+            heap->collect(true);
+#endif
+            if (heap->m_nursery == nullptr && heap->m_oldGeneration == nullptr) {
+                delete heap;
+            }
+        }
+    };
+
+    thread_local Owner owner;
+    return *owner.heap;
+}
+
+void* app::CoreHeap::allocate(const size_t size)
+{
+    if (size > MAX_SMALL_SIZE) {
+        m_statistics.heapSize += size;
+        return ::operator new(size);
+    }
+
+    const auto sizeClass = (size + SIZE_CLASS_STEP - 1) / SIZE_CLASS_STEP - 1;
+    if (auto* block = m_freeBlocks[sizeClass]; block != nullptr) {
+        m_freeBlocks[sizeClass] = block->next;
+        return block;
+    }
+
+    const auto blockSize = (sizeClass + 1) * SIZE_CLASS_STEP;
+    if (static_cast<size_t>(m_bumpEnd - m_bumpPointer) < blockSize) {
+        m_chunks.emplace_back(new std::byte[CHUNK_SIZE]);
+        m_bumpPointer = m_chunks.back().get();
+        m_bumpEnd = m_bumpPointer + CHUNK_SIZE;
+        m_statistics.heapSize += CHUNK_SIZE;
+    }
+
+    auto* memory = m_bumpPointer;
+    m_bumpPointer += blockSize;
+    return memory;
+}
+
+void app::CoreHeap::deallocate(void* memory, const size_t size) noexcept
+{
+    if (size > MAX_SMALL_SIZE) {
+        m_statistics.heapSize -= size;
+        ::operator delete(memory);
+        return;
+    }
+
+    const auto sizeClass = (size + SIZE_CLASS_STEP - 1) / SIZE_CLASS_STEP - 1;
+    m_freeBlocks[sizeClass] = new (memory) FreeBlock{ m_freeBlocks[sizeClass] };
+}
+
+void app::CoreHeap::add(CoreObject& object)
+{
+    // The new object is not linked yet, so collections don't see it
+    collectIfNeeded();
+
+    object.m_nextObject = m_nursery;
+    if (m_nursery != nullptr) {
+        m_nursery->m_previousObject = &object;
+    }
+    m_nursery = &object;
+    ++m_statistics.nurseryObjects;
+}
+
+void app::CoreHeap::remove(CoreObject& object) noexcept
+{
+    auto& first = object.m_old ? m_oldGeneration : m_nursery;
+
+    if (object.m_previousObject != nullptr) {
+        object.m_previousObject->m_nextObject = object.m_nextObject;
+    }
+    else {
+        first = object.m_nextObject;
+    }
+    if (object.m_nextObject != nullptr) {
+        object.m_nextObject->m_previousObject = object.m_previousObject;
+    }
+
+    --(object.m_old ? m_statistics.oldObjects : m_statistics.nurseryObjects);
+}
+
+void app::CoreHeap::destroy(const CoreObject& object) noexcept
+{
+    m_releasedObjects.push_back(&object);
+    if (m_destroying) {
+        return;
+    }
+    m_destroying = true;
+
+    while (!m_releasedObjects.empty()) {
+        const auto* released = m_releasedObjects.back();
+        m_releasedObjects.pop_back();
+        delete released;
+    }
+
+    m_destroying = false;
+}
+
+size_t app::CoreHeap::collect(const bool full)
+{
+    if (m_collecting) {
+        return 0;
+    }
+    m_collecting = true;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Old objects are collected together with the nursery
+    const auto forEachCandidate = [this, full](const auto& f) {
+        for (auto* list : { m_nursery, full ? m_oldGeneration : nullptr }) {
+            for (auto* object = list; object != nullptr; object = object->m_nextObject) {
+                f(object);
+            }
+        }
+    };
+
+    std::vector<Symbol*> symbols;
+    const auto forEachTarget = [&symbols, full](CoreObject* object, const auto& f) {
+        symbols.clear();
+        object->collectSymbols(symbols);
+        for (auto* symbol : symbols) {
+            if (auto* target = symbol->getValue().getCoreObject(); target != nullptr && (full || !target->m_old)) {
+                f(target);
+            }
+        }
+    };
+
+    // References held by candidates, the others come from variables, stacks, old objects and the host
+    forEachCandidate([](CoreObject* object) {
+        object->m_internalReferences = 0;
+        object->m_alive = false;
+    });
+    forEachCandidate([&forEachTarget](CoreObject* object) {
+        forEachTarget(object, [](CoreObject* target) {
+            ++target->m_internalReferences;
+        });
+    });
+
+    // Objects referenced from outside, and objects they reach, are alive.
+    // Objects without references are being created or destroyed
+    std::vector<CoreObject*> pending;
+    forEachCandidate([&pending](CoreObject* object) {
+        const auto references = object->getReferenceCount();
+        if (references == 0 || references > object->m_internalReferences) {
+            object->m_alive = true;
+            pending.push_back(object);
+        }
+    });
+
+    while (!pending.empty()) {
+        auto* object = pending.back();
+        pending.pop_back();
+
+        forEachTarget(object, [&pending](CoreObject* target) {
+            if (!target->m_alive) {
+                target->m_alive = true;
+                pending.push_back(target);
+            }
+        });
+    }
+
+    // Garbage is kept until all of its cycles are broken
+    std::vector<CoreObjectPtr> garbage;
+    forEachCandidate([&garbage](CoreObject* object) {
+        if (!object->m_alive) {
+            garbage.emplace_back(object);
+        }
+    });
+
+    for (const auto& object : garbage) {
+        symbols.clear();
+        object->collectSymbols(symbols);
+        for (auto* symbol : symbols) {
+            *symbol = Symbol{ symbol->getValueCategory() };
+        }
+    }
+
+    const auto collected = garbage.size();
+    garbage.clear();
+
+    // Survivors of the nursery are promoted
+    while (m_nursery != nullptr) {
+        auto* object = m_nursery;
+        remove(*object);
+
+        object->m_old = true;
+        object->m_previousObject = nullptr;
+        object->m_nextObject = m_oldGeneration;
+        if (m_oldGeneration != nullptr) {
+            m_oldGeneration->m_previousObject = object;
+        }
+        m_oldGeneration = object;
+        ++m_statistics.oldObjects;
+    }
+
+    const auto pause = std::chrono::steady_clock::now() - start;
+    ++(full ? m_statistics.majorCollections : m_statistics.minorCollections);
+    m_statistics.collectedObjects += collected;
+    m_statistics.totalPause += pause;
+    m_statistics.maxPause = std::max<std::chrono::nanoseconds>(m_statistics.maxPause, pause);
+
+    m_collecting = false;
+    return collected;
+}
+
+const app::CoreHeap::Statistics& app::CoreHeap::getStatistics() const
+{
+    return m_statistics;
+}
+
+void app::CoreHeap::collectIfNeeded()
+{
+#ifndef USL_NO_CYCLE_COLLECTOR
+    if (m_statistics.nurseryObjects < NURSERY_SIZE) {
+        return;
+    }
+
+    collect(false);
+    if (m_statistics.oldObjects >= m_oldGenerationLimit) {
+        collect(true);
+        m_oldGenerationLimit = std::max(MIN_OLD_GENERATION_SIZE, m_statistics.oldObjects * 2);
+    }
+#endif
+}
@@ -1,11 +1,142 @@
 #include "CoreObject.hpp"
 
-app::Symbol app::CoreObject::getMember(const std::string& name)
+#include <mutex>
+
+#include "CoreClass.hpp"
+#include "CoreHeap.hpp"
+#include "MemoryAccount.hpp"
+
+namespace details
+{
+    // Shapes are shared by all threads, only their transitions change
+    std::mutex transitionsMutex;
+
+    // Account charged for an object is stored in front of it
+    constexpr size_t ACCOUNT_HEADER_SIZE = alignof(std::max_align_t);
+
+    std::pmr::memory_resource* getMembersResource()
+    {
+        auto* account = app::MemoryAccount::getCurrent();
+        return account != nullptr ? account->getResource(app::MemoryAccount::Category::Objects) : std::pmr::get_default_resource();
+    }
+}
+
+app::CoreObjectShape::CoreObjectShape(const CoreClass* coreClass) :
+    m_class(coreClass)
+{
+}
+
+const app::CoreObjectShape* app::CoreObjectShape::getEmpty()
+{
+    static const CoreObjectShape empty;
+    return &empty;
+}
+
+const app::CoreObjectShape* app::CoreObjectShape::add(const std::string& name) const
+{
+    const std::lock_guard lock{ details::transitionsMutex };
+
+    auto& shape = m_transitions[name];
+    if (shape == nullptr) {
+        shape = std::make_unique<CoreObjectShape>(m_class);
+        shape->m_indices = m_indices;
+        shape->m_indices.emplace(name, m_indices.size());
+    }
+
+    return shape.get();
+}
+
+std::optional<size_t> app::CoreObjectShape::find(const std::string& name) const
+{
+    const auto it = m_indices.find(name);
+    if (it == m_indices.end()) {
+        return std::nullopt;
+    }
+
+    return it->second;
+}
+
+size_t app::CoreObjectShape::getSize() const
+{
+    return m_indices.size();
+}
+
+const app::CoreClass* app::CoreObjectShape::getClass() const
+{
+    return m_class;
+}
+
+app::CoreObject::CoreObject() :
+    m_members(details::getMembersResource())
+{
+    CoreHeap::get().add(*this);
+}
+
+app::CoreObject::CoreObject(const CoreClass& coreClass) :
+    m_shape(coreClass.getShape()),
+    m_members(m_shape->getSize(), Symbol{ Symbol::ValueCategory::Lvalue }, details::getMembersResource())
+{
+    CoreHeap::get().add(*this);
+}
+
+app::CoreObject::~CoreObject()
+{
+    CoreHeap::get().remove(*this);
+}
+
+void* app::CoreObject::operator new(const size_t size)
+{
+    auto* account = MemoryAccount::getCurrent();
+    if (account != nullptr) {
+        account->charge(MemoryAccount::Category::Objects, size);
+    }
+
+    auto* memory = static_cast<std::byte*>(CoreHeap::get().allocate(details::ACCOUNT_HEADER_SIZE + size));
+    *reinterpret_cast<MemoryAccount**>(memory) = account;
+    return memory + details::ACCOUNT_HEADER_SIZE;
+}
+
+void app::CoreObject::operator delete(void* memory, const size_t size) noexcept
+{
+    auto* header = static_cast<std::byte*>(memory) - details::ACCOUNT_HEADER_SIZE;
+    if (auto* account = *reinterpret_cast<MemoryAccount**>(header); account != nullptr) {
+        account->discharge(MemoryAccount::Category::Objects, size);
+    }
+
+    CoreHeap::get().deallocate(header, details::ACCOUNT_HEADER_SIZE + size);
+}
+
+void app::CoreObject::collectSymbols(std::vector<Symbol*>& symbols)
+{
+    for (auto& member : m_members) {
+        symbols.push_back(&member);
+    }
+}
+
+void app::CoreObject::resolveMember(const std::string_view name, MemberCache& cache) const
+{
+    const auto key = std::string{ name };
+
+    if (const auto index = m_shape->find(key); index.has_value()) {
+        cache = MemberCache{ m_shape, *index, nullptr };
+        return;
+    }
+
+    const auto* coreClass = m_shape->getClass();
+    const auto* method = coreClass != nullptr ? coreClass->findMethod(key) : nullptr;
+    if (method == nullptr) {
+        throw std::runtime_error{ "Unable to find member " + key };
+    }
+
+    cache = MemberCache{ m_shape, 0, method };
+}
+
+size_t app::CoreObject::findField(const std::string& name) const
 {
-    auto it = m_members.find(name);
-    if (it == m_members.end()) {
-        throw std::runtime_error{ "Unable to find member " + std::string{name} };
+    const auto index = m_shape->find(name);
+    if (!index.has_value()) {
+        throw std::runtime_error{ "Unable to find member " + name };
     }
 
-    return Symbol{ &it->second };
+    return *index;
 }
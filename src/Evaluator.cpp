@@ -1,142 +1,695 @@
 #include "Evaluator.hpp"
 
+#include <iterator>
+#include <algorithm>
+#include <limits>
+
 #include "CoreObject.hpp"
 #include "CoreFunction.hpp"
+#include "CoreHeap.hpp"
+#include "Profiler.hpp"
 
-app::Evaluator::Evaluator(const bool loggingEnabled) :
-    m_loggingEnabled(loggingEnabled)
-{
-    m_blocks.emplace_back();
-}
+// Labels as values let every handler jump to the next one directly
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(USL_NO_THREADED_DISPATCH)
+#define USL_THREADED_DISPATCH
+#endif
 
-void app::Evaluator::eval(const std::vector<ByteCodeItem>& byteCode)
+namespace details
 {
-    size_t step = 0;
-    while (m_position < byteCode.size()) {
-        const auto& item = byteCode[m_position];
+    // Handler index of each bytecode item: opcodes come first, then other item kinds
+    namespace DispatchCode {
+        enum : uint8_t
+        {
+            Pointer = static_cast<uint8_t>(app::OpCode::Count),
+            Name,
+            Local,
+            Global,
+            Null,
+            Boolean,
+            Number,
+            String,
+            End,
+
+            // Type specialized instructions, see Evaluator::handleBinaryOperator
+            ADD_NUM_NUM,
+            SUB_NUM_NUM,
+            MUL_NUM_NUM,
+            DIV_NUM_NUM,
+            EQ_NUM_NUM,
+            NEQ_NUM_NUM,
+            LT_NUM_NUM,
+            LE_NUM_NUM,
+            GT_NUM_NUM,
+            GE_NUM_NUM,
+            LT_JMP_NUM_NUM,
+            ADD_STR_STR,
+
+            Count,
+        };
+    }
 
-        if (m_loggingEnabled) {
-            printf("\n== step: %zu | position: %zu ==\n", step++, m_position);
-            printState(true);
+    // Specialized instruction for the operand types, or the instruction itself
+    uint8_t quicken(const app::OpCode op, const app::Value& left, const app::Value& right)
+    {
+        using app::OpCode;
+
+        if (left.isNumber() && right.isNumber()) {
+            switch (op) {
+            case OpCode::ADD: return DispatchCode::ADD_NUM_NUM;
+            case OpCode::SUB: return DispatchCode::SUB_NUM_NUM;
+            case OpCode::MUL: return DispatchCode::MUL_NUM_NUM;
+            case OpCode::DIV: return DispatchCode::DIV_NUM_NUM;
+            case OpCode::EQ: return DispatchCode::EQ_NUM_NUM;
+            case OpCode::NEQ: return DispatchCode::NEQ_NUM_NUM;
+            case OpCode::LT: return DispatchCode::LT_NUM_NUM;
+            case OpCode::LE: return DispatchCode::LE_NUM_NUM;
+            case OpCode::GT: return DispatchCode::GT_NUM_NUM;
+            case OpCode::GE: return DispatchCode::GE_NUM_NUM;
+            case OpCode::LT_JMP: return DispatchCode::LT_JMP_NUM_NUM;
+            default: break;
+            }
+        }
+        else if (op == OpCode::ADD && left.isString() && right.isString()) {
+            return DispatchCode::ADD_STR_STR;
         }
 
-        std::visit([this](auto && arg) {
-            using T = std::decay_t<decltype(arg)>;
+        return static_cast<uint8_t>(op);
+    }
 
-            if constexpr (!std::is_same_v<T, OpCode>) {
-                if constexpr (std::is_same_v<T, Pointer>) {
-                    m_pointerStack.push(arg);
+    template<app::OpCode Op>
+    app::Symbol calculate(const double left, const double right)
+    {
+        using app::OpCode;
+        constexpr auto category = app::Symbol::ValueCategory::Rvalue;
+
+        if constexpr (Op == OpCode::ADD) return app::Symbol{ left + right, category };
+        if constexpr (Op == OpCode::SUB) return app::Symbol{ left - right, category };
+        if constexpr (Op == OpCode::MUL) return app::Symbol{ left * right, category };
+        if constexpr (Op == OpCode::DIV) return app::Symbol{ left / right, category };
+        if constexpr (Op == OpCode::EQ) return app::Symbol{ left == right, category };
+        if constexpr (Op == OpCode::NEQ) return app::Symbol{ left != right, category };
+        if constexpr (Op == OpCode::LT) return app::Symbol{ left < right, category };
+        if constexpr (Op == OpCode::LE) return app::Symbol{ left <= right, category };
+        if constexpr (Op == OpCode::GT) return app::Symbol{ left > right, category };
+        if constexpr (Op == OpCode::GE) return app::Symbol{ left >= right, category };
+    }
+
+    std::vector<uint8_t> createDispatchCodes(const std::vector<app::ByteCodeItem>& byteCode)
+    {
+        std::vector<uint8_t> result;
+        result.reserve(byteCode.size() + 1);
+
+        for (const auto& item : byteCode) {
+            result.push_back(std::visit([](auto && arg) -> uint8_t {
+                using T = std::decay_t<decltype(arg)>;
+
+                if constexpr (std::is_same_v<T, app::OpCode>) {
+                    return static_cast<uint8_t>(arg);
+                }
+                else if constexpr (std::is_same_v<T, app::Pointer>) {
+                    return DispatchCode::Pointer;
                 }
                 else if constexpr (std::is_same_v<T, std::string_view>) {
-                    m_stack.emplace_back(arg);
+                    return DispatchCode::Name;
+                }
+                else if constexpr (std::is_same_v<T, app::LocalSlot>) {
+                    return DispatchCode::Local;
+                }
+                else if constexpr (std::is_same_v<T, app::GlobalSlot>) {
+                    return DispatchCode::Global;
+                }
+                else if constexpr (std::is_same_v<T, std::nullopt_t>) {
+                    return DispatchCode::Null;
+                }
+                else if constexpr (std::is_same_v<T, bool>) {
+                    return DispatchCode::Boolean;
+                }
+                else if constexpr (std::is_same_v<T, double>) {
+                    return DispatchCode::Number;
                 }
                 else {
-                    m_stack.emplace_back(Symbol{ arg, Symbol::ValueCategory::Rvalue });
+                    return DispatchCode::String;
                 }
+            }, item));
+        }
+        result.push_back(DispatchCode::End);
 
-                ++m_position;
-                return;
-            }
-            else {
-                if (m_loggingEnabled) {
-                    printf("[OP] %s\n", toString(arg).c_str());
-                }
+        return result;
+    }
 
-                switch (arg) {
-                case OpCode::DECLVAR:
-                case OpCode::DECLFUN:
-                    handleDecl(arg);
-                    break;
-
-                case OpCode::ASSIGN:
-                case OpCode::ASSIGNREF:
-                    handleAssign(arg);
-                    break;
-
-                case OpCode::POP:
-                    handlePop();
-                    break;
-
-                case OpCode::DEREF:
-                    handleDeref();
-                    break;
-
-                case OpCode::STRUCTREF:
-                    handleStructRef();
-                    break;
-
-                case OpCode::NOT:
-                case OpCode::UNM:
-                    handleUnaryOperator(arg);
-                    break;
-
-                case OpCode::ADD:
-                case OpCode::SUB:
-                case OpCode::MUL:
-                case OpCode::DIV:
-                case OpCode::AND:
-                case OpCode::OR:
-                case OpCode::EQ:
-                case OpCode::NEQ:
-                case OpCode::LT:
-                case OpCode::LE:
-                case OpCode::GT:
-                case OpCode::GE:
-                    handleBinaryOperator(arg);
-                    break;
-
-                case OpCode::IF:
-                case OpCode::JMP:
-                case OpCode::CALL:
-                case OpCode::RET:
-                    handleControl(arg);
-                    break;
-
-                case OpCode::PUSHARG:
-                case OpCode::POPARG:
-                    handleArguments(arg);
-                    break;
-
-                case OpCode::DEFBLOCK:
-                case OpCode::DELBLOCK:
-                    handleBlocks(arg);
-                    break;
-
-                default:
-                    throw std::runtime_error("Unknown opcode");
-                }
-            }
-        }, item);
+    // Kept out of slot lookups, so they stay small enough to be inlined into the handlers
+    [[noreturn]] void throwMissingVariable(const std::string_view name)
+    {
+        throw std::runtime_error{ "Unable to find variable: '" + std::string{ name } + "'" };
+    }
+}
+
+app::Evaluator::Evaluator(const bool loggingEnabled) :
+    m_loggingEnabled(loggingEnabled),
+    m_blocks(64, m_memory.getResource(MemoryAccount::Category::Scopes)),
+    m_freeBlocks(m_memory.getResource(MemoryAccount::Category::Scopes)),
+    m_globals(m_memory.getResource(MemoryAccount::Category::Symbols)),
+    m_locals(m_memory.getResource(MemoryAccount::Category::Symbols)),
+    m_frames(256, m_memory.getResource(MemoryAccount::Category::Symbols)),
+    m_stack(256, m_memory.getResource(MemoryAccount::Category::Symbols)),
+    m_pointerStack(256, m_memory.getResource(MemoryAccount::Category::Symbols))
+{
+    // Variables are referenced by address, moving blocks must not move their nodes
+    static_assert(std::is_nothrow_move_constructible_v<Block>);
+
+    m_blocks.emplace();
+}
+
+app::Evaluator::~Evaluator()
+{
+    // Cycles left by the script are charged to the memory account, they are freed before it
+    m_stack.clear();
+    m_blocks.clear();
+    m_freeBlocks.clear();
+    m_freeVariables.clear();
+    m_globals.clear();
+    m_locals.clear();
+    m_methodObject = nullptr;
+
+#ifndef USL_NO_CYCLE_COLLECTOR
+    CoreHeap::get().collect(true);
+#endif
+}
+
+void app::Evaluator::eval(const std::vector<ByteCodeItem>& byteCode, const bool verified)
+{
+    load(byteCode, verified);
+    m_instructionLimit = std::numeric_limits<size_t>::max();
+
+    const MemoryAccount::Scope scope{ &m_memory };
+
+    if (verified) {
+        execute<false>();
+    }
+    else {
+        execute<true>();
+    }
+}
+
+void app::Evaluator::load(const std::vector<ByteCodeItem>& byteCode, const bool verified)
+{
+    const auto size = byteCode.size();
+
+    // Instructions are quickened in place after they run
+    m_byteCode = &byteCode;
+    m_codes = details::createDispatchCodes(byteCode);
+    m_verified = verified;
+    m_status = Status::Yielded;
+    m_error.clear();
+    m_position = 0;
+    m_traceStep = 0;
+
+    m_memberCaches.assign(size, MemberCache{});
+    m_dequickened.assign(size, false);
+
+    m_strings.assign(size, Value{});
+    for (size_t i = 0; i < size; ++i) {
+        if (const auto* text = std::get_if<std::string>(&byteCode[i]); text != nullptr) {
+            m_strings[i] = Value::intern(*text);
+        }
+    }
+}
+
+app::Evaluator::Status app::Evaluator::run(const size_t maxInstructions)
+{
+    if (m_status != Status::Yielded) {
+        return m_status;
+    }
+
+    const auto limit = m_instructionCount + maxInstructions;
+    m_instructionLimit = limit < m_instructionCount ? std::numeric_limits<size_t>::max() : limit;
+
+    const MemoryAccount::Scope scope{ &m_memory };
+
+    // State of a failed evaluation is left as it was, it can't be resumed
+    try {
+        m_status = m_verified ? execute<false>() : execute<true>();
+    }
+    catch (const std::exception& e) {
+        m_status = Status::Error;
+        m_error = e.what();
     }
 
+    return m_status;
+}
+
+const std::string& app::Evaluator::getError() const
+{
+    return m_error;
+}
+
+template<bool Checked>
+app::Evaluator::Status app::Evaluator::execute()
+{
+    namespace DispatchCode = details::DispatchCode;
+
+    const auto& byteCode = *m_byteCode;
+    auto* codes = m_codes.data();
+    const auto size = byteCode.size();
+
+    const auto traced = m_loggingEnabled || m_profiler != nullptr;
+
+#ifdef USL_THREADED_DISPATCH
+    // Each handler jumps to the next one directly. Order matches DispatchCode
+    static const void* const targets[] = {
+        &&op_DECLVAR, &&op_DECLFUN, &&op_ASSIGN, &&op_ASSIGNREF,
+        &&op_DEREF, &&op_STRUCTREF, &&op_POP, &&op_NOT, &&op_UNM,
+        &&op_ADD, &&op_SUB, &&op_MUL, &&op_DIV, &&op_AND, &&op_OR,
+        &&op_EQ, &&op_NEQ, &&op_LT, &&op_LE, &&op_GT, &&op_GE,
+        &&op_IF, &&op_JMP, &&op_CALL, &&op_RET, &&op_PUSHARG, &&op_DECLARG, &&op_DECLARGREF,
+        &&op_DEFBLOCK, &&op_DELBLOCK, &&op_INCVAR, &&op_LT_JMP, &&op_CALL_MEMBER, &&op_TAILCALL,
+        &&item_Pointer, &&item_Name, &&item_Local, &&item_Global,
+        &&item_Null, &&item_Boolean, &&item_Number, &&item_String,
+        &&item_End,
+        &&quick_ADD_NUM_NUM, &&quick_SUB_NUM_NUM, &&quick_MUL_NUM_NUM, &&quick_DIV_NUM_NUM,
+        &&quick_EQ_NUM_NUM, &&quick_NEQ_NUM_NUM, &&quick_LT_NUM_NUM, &&quick_LE_NUM_NUM,
+        &&quick_GT_NUM_NUM, &&quick_GE_NUM_NUM, &&quick_LT_JMP_NUM_NUM, &&quick_ADD_STR_STR,
+    };
+    static_assert(std::size(targets) == DispatchCode::Count);
+
+#define USL_TARGET(label, code) label
+#define USL_DISPATCH() goto *targets[next()]
+#else
+#define USL_TARGET(label, code) case code
+#define USL_DISPATCH() continue
+#endif
+
+// Jumps and calls end the slice when the budget is spent, every loop passes one of them
+#define USL_BRANCH() if (m_instructionCount >= m_instructionLimit) goto yield; USL_DISPATCH()
+
+#define USL_OP(name) USL_TARGET(op_##name, static_cast<uint8_t>(OpCode::name))
+#define USL_ITEM(name) USL_TARGET(item_##name, DispatchCode::name)
+#define USL_QUICK(name) USL_TARGET(quick_##name, DispatchCode::name)
+
+    const auto next = [&]() {
+        const auto code = codes[std::min(m_position, size)];
+
+        if (traced && code != DispatchCode::End) {
+            trace(byteCode[m_position], m_traceStep++);
+        }
+
+        ++m_instructionCount;
+        return code;
+    };
+
+#ifdef USL_THREADED_DISPATCH
+    USL_DISPATCH();
+#else
+    while (true) {
+        switch (next()) {
+#endif
+
+    USL_OP(DECLVAR): handleDecl<Checked>(OpCode::DECLVAR); USL_DISPATCH();
+    USL_OP(DECLFUN): handleDecl<Checked>(OpCode::DECLFUN); USL_DISPATCH();
+    USL_OP(ASSIGN): handleAssign<Checked>(OpCode::ASSIGN); USL_DISPATCH();
+    USL_OP(ASSIGNREF): handleAssign<Checked>(OpCode::ASSIGNREF); USL_DISPATCH();
+    USL_OP(INCVAR): handleAssign<Checked>(OpCode::INCVAR); USL_DISPATCH();
+    USL_OP(DEREF): handleDeref<Checked>(); USL_DISPATCH();
+    USL_OP(STRUCTREF): handleStructRef<Checked>(codes[m_position + 1] == static_cast<uint8_t>(OpCode::CALL)); USL_DISPATCH();
+    USL_OP(POP): handlePop<Checked>(); USL_DISPATCH();
+    USL_OP(NOT): handleUnaryOperator<Checked>(OpCode::NOT); USL_DISPATCH();
+    USL_OP(UNM): handleUnaryOperator<Checked>(OpCode::UNM); USL_DISPATCH();
+    USL_OP(ADD): handleBinaryOperator<Checked>(OpCode::ADD, codes[m_position]); USL_DISPATCH();
+    USL_OP(SUB): handleBinaryOperator<Checked>(OpCode::SUB, codes[m_position]); USL_DISPATCH();
+    USL_OP(MUL): handleBinaryOperator<Checked>(OpCode::MUL, codes[m_position]); USL_DISPATCH();
+    USL_OP(DIV): handleBinaryOperator<Checked>(OpCode::DIV, codes[m_position]); USL_DISPATCH();
+    USL_OP(AND): handleBinaryOperator<Checked>(OpCode::AND, codes[m_position]); USL_DISPATCH();
+    USL_OP(OR): handleBinaryOperator<Checked>(OpCode::OR, codes[m_position]); USL_DISPATCH();
+    USL_OP(EQ): handleBinaryOperator<Checked>(OpCode::EQ, codes[m_position]); USL_DISPATCH();
+    USL_OP(NEQ): handleBinaryOperator<Checked>(OpCode::NEQ, codes[m_position]); USL_DISPATCH();
+    USL_OP(LT): handleBinaryOperator<Checked>(OpCode::LT, codes[m_position]); USL_DISPATCH();
+    USL_OP(LE): handleBinaryOperator<Checked>(OpCode::LE, codes[m_position]); USL_DISPATCH();
+    USL_OP(GT): handleBinaryOperator<Checked>(OpCode::GT, codes[m_position]); USL_DISPATCH();
+    USL_OP(GE): handleBinaryOperator<Checked>(OpCode::GE, codes[m_position]); USL_DISPATCH();
+    USL_OP(IF): handleControl<Checked>(OpCode::IF); USL_BRANCH();
+    USL_OP(JMP): handleControl<Checked>(OpCode::JMP); USL_BRANCH();
+    USL_OP(CALL): handleControl<Checked>(OpCode::CALL); USL_BRANCH();
+    USL_OP(RET): handleControl<Checked>(OpCode::RET); USL_BRANCH();
+    USL_OP(CALL_MEMBER): handleControl<Checked>(OpCode::CALL_MEMBER); USL_BRANCH();
+    USL_OP(TAILCALL): handleControl<Checked>(OpCode::TAILCALL); USL_BRANCH();
+    USL_OP(LT_JMP): handleCompareJump<Checked>(codes[m_position]); USL_BRANCH();
+    USL_OP(PUSHARG): handleArguments<Checked>(OpCode::PUSHARG); USL_DISPATCH();
+    USL_OP(DECLARG): handleArguments<Checked>(OpCode::DECLARG); USL_DISPATCH();
+    USL_OP(DECLARGREF): handleArguments<Checked>(OpCode::DECLARGREF); USL_DISPATCH();
+    USL_OP(DEFBLOCK): handleBlocks<Checked>(OpCode::DEFBLOCK); USL_DISPATCH();
+    USL_OP(DELBLOCK): handleBlocks<Checked>(OpCode::DELBLOCK); USL_DISPATCH();
+
+    USL_QUICK(ADD_NUM_NUM): handleNumberOperator<Checked, OpCode::ADD>(codes[m_position]); USL_DISPATCH();
+    USL_QUICK(SUB_NUM_NUM): handleNumberOperator<Checked, OpCode::SUB>(codes[m_position]); USL_DISPATCH();
+    USL_QUICK(MUL_NUM_NUM): handleNumberOperator<Checked, OpCode::MUL>(codes[m_position]); USL_DISPATCH();
+    USL_QUICK(DIV_NUM_NUM): handleNumberOperator<Checked, OpCode::DIV>(codes[m_position]); USL_DISPATCH();
+    USL_QUICK(EQ_NUM_NUM): handleNumberOperator<Checked, OpCode::EQ>(codes[m_position]); USL_DISPATCH();
+    USL_QUICK(NEQ_NUM_NUM): handleNumberOperator<Checked, OpCode::NEQ>(codes[m_position]); USL_DISPATCH();
+    USL_QUICK(LT_NUM_NUM): handleNumberOperator<Checked, OpCode::LT>(codes[m_position]); USL_DISPATCH();
+    USL_QUICK(LE_NUM_NUM): handleNumberOperator<Checked, OpCode::LE>(codes[m_position]); USL_DISPATCH();
+    USL_QUICK(GT_NUM_NUM): handleNumberOperator<Checked, OpCode::GT>(codes[m_position]); USL_DISPATCH();
+    USL_QUICK(GE_NUM_NUM): handleNumberOperator<Checked, OpCode::GE>(codes[m_position]); USL_DISPATCH();
+    USL_QUICK(LT_JMP_NUM_NUM): handleNumberCompareJump<Checked>(codes[m_position]); USL_BRANCH();
+    USL_QUICK(ADD_STR_STR): handleStringConcatenation<Checked>(codes[m_position]); USL_DISPATCH();
+
+    USL_ITEM(Pointer):
+        m_pointerStack.push(*std::get_if<Pointer>(&byteCode[m_position++]));
+        USL_DISPATCH();
+    USL_ITEM(Name):
+        m_stack.emplace(*std::get_if<std::string_view>(&byteCode[m_position++]));
+        USL_DISPATCH();
+    USL_ITEM(Local):
+        m_stack.emplace(*std::get_if<LocalSlot>(&byteCode[m_position++]));
+        USL_DISPATCH();
+    USL_ITEM(Global):
+        m_stack.emplace(*std::get_if<GlobalSlot>(&byteCode[m_position++]));
+        USL_DISPATCH();
+    USL_ITEM(Null):
+        m_stack.emplace(Symbol{ Symbol::ValueCategory::Rvalue });
+        ++m_position;
+        USL_DISPATCH();
+    USL_ITEM(Boolean):
+        m_stack.emplace(Symbol{ *std::get_if<bool>(&byteCode[m_position++]), Symbol::ValueCategory::Rvalue });
+        USL_DISPATCH();
+    USL_ITEM(Number):
+        m_stack.emplace(Symbol{ *std::get_if<double>(&byteCode[m_position++]), Symbol::ValueCategory::Rvalue });
+        USL_DISPATCH();
+    USL_ITEM(String):
+        m_stack.emplace(Symbol{ m_strings[m_position++], Symbol::ValueCategory::Rvalue });
+        USL_DISPATCH();
+
+#ifndef USL_THREADED_DISPATCH
+    case DispatchCode::End:
+        break;
+
+    default:
+        throw std::runtime_error("Unknown opcode");
+        }
+        break;
+    }
+#else
+    item_End:
+#endif
+
+#undef USL_QUICK
+#undef USL_ITEM
+#undef USL_OP
+#undef USL_BRANCH
+#undef USL_DISPATCH
+#undef USL_TARGET
+
+    // End of the code is not an instruction
+    --m_instructionCount;
+
     if (m_loggingEnabled) {
         printf("\n== end ==\n");
         printState(true);
     }
+    return Status::Finished;
+
+yield:
+    return Status::Yielded;
 }
 
 void app::Evaluator::push(const Symbol& symbol)
 {
-    m_stack.emplace_back(symbol);
+    m_stack.emplace(symbol);
+}
+
+void app::Evaluator::push(Symbol&& symbol)
+{
+    m_stack.emplace(std::move(symbol));
+}
+
+app::Symbol app::Evaluator::pop()
+{
+    if (m_stack.empty()) {
+        throw std::runtime_error{ "Unable to pop value. Stack is empty" };
+    }
+
+    auto value = std::move(m_stack.top());
+    m_stack.pop();
+
+    if (auto* symbol = std::get_if<Symbol>(&value); symbol != nullptr) {
+        return std::move(*symbol);
+    }
+
+    Symbol result{ Symbol::ValueCategory::Rvalue };
+    visitSymbol([&result](const Symbol& symbol) {
+        result = symbol;
+    }, value);
+
+    return result;
+}
+
+size_t app::Evaluator::getStackSize() const
+{
+    return m_stack.size();
+}
+
+size_t app::Evaluator::getInstructionCount() const
+{
+    return m_instructionCount;
+}
+
+void app::Evaluator::setStackLimit(const size_t limit)
+{
+    m_blocks.setLimit(limit);
+    m_frames.setLimit(limit);
+    m_stack.setLimit(limit);
+    m_pointerStack.setLimit(limit);
+}
+
+app::MemoryAccount& app::Evaluator::getMemory()
+{
+    return m_memory;
+}
+
+void app::Evaluator::setProfiler(Profiler* profiler)
+{
+    m_profiler = profiler;
+}
+
+void app::Evaluator::declareVariable(const std::string_view name)
+{
+    if (m_blocks.top().count(name) != 0) {
+        throw std::runtime_error{ "Variable with name " + std::string{ name } + "already exists" };
+    }
+
+    declareNamed(name, Symbol{ Symbol::ValueCategory::Lvalue });
+}
+
+void app::Evaluator::declareVariable(const LocalSlot slot)
+{
+    const auto index = m_frameBase + slot.index;
+    if (m_locals.size() <= index) {
+        m_locals.resize(index + 1, Symbol{ Symbol::ValueCategory::Lvalue });
+    }
+
+    m_locals[index] = Symbol{ Symbol::ValueCategory::Lvalue };
+}
+
+void app::Evaluator::declareVariable(const GlobalSlot slot)
+{
+    if (m_globals.size() <= slot.index) {
+        m_globals.resize(slot.index + 1, Symbol{ Symbol::ValueCategory::Lvalue });
+    }
+
+    m_globals[slot.index] = Symbol{ Symbol::ValueCategory::Lvalue };
+}
+
+void app::Evaluator::declareFunction(const std::string_view name, const Pointer address)
+{
+    if (m_blocks.top().count(name) != 0) {
+        throw std::runtime_error{ "Function with name " + std::string{ name } +"already exists" };
+    }
+
+    declareNamed(name, Symbol{ ScriptFunction{ address }, Symbol::ValueCategory::Lvalue });
+}
+
+void app::Evaluator::declareFunction(const GlobalSlot slot, const Pointer address)
+{
+    declareVariable(slot);
+    m_globals[slot.index] = Symbol{ ScriptFunction{ address }, Symbol::ValueCategory::Lvalue };
 }
 
 app::Symbol& app::Evaluator::findVariable(const std::string_view name)
 {
-    for (auto block = m_blocks.rbegin(); block != m_blocks.rend(); ++block) {
-        const auto it = block->find(name);
-        if (it != block->end()) {
-            return it->second;
-        }        
+    auto* variable = findNamed(name);
+    if (variable == nullptr) {
+        details::throwMissingVariable(name);
+    }
+
+    return *variable;
+}
+
+app::Symbol& app::Evaluator::findVariable(const LocalSlot slot)
+{
+    const auto index = m_frameBase + slot.index;
+    if (index >= m_locals.size()) {
+        details::throwMissingVariable(getName(slot));
+    }
+
+    return m_locals[index];
+}
+
+app::Symbol& app::Evaluator::findVariable(const GlobalSlot slot)
+{
+    if (slot.index >= m_globals.size()) {
+        details::throwMissingVariable(getName(slot));
     }
 
-    throw std::runtime_error{ "Unable to find variable: '" + std::string(name) + "'" };
+    return m_globals[slot.index];
 }
 
 bool app::Evaluator::hasVariable(const std::string_view name) const
 {
-    for (auto block = m_blocks.rbegin(); block != m_blocks.rend(); ++block) {
-        const auto it = block->find(name);
-        if (it != block->end()) {
+    return const_cast<Evaluator*>(this)->findNamed(name) != nullptr;
+}
+
+void app::Evaluator::pushBlock()
+{
+    if (m_freeBlocks.empty()) {
+        m_blocks.emplace();
+        return;
+    }
+
+    m_blocks.emplace(std::move(m_freeBlocks.back()));
+    m_freeBlocks.pop_back();
+}
+
+void app::Evaluator::popBlock()
+{
+    if (m_blocks.size() <= 1) {
+        throw std::runtime_error{ "Unable to delete scope block" };
+    }
+
+    releaseBlock();
+}
+
+void app::Evaluator::releaseBlock()
+{
+    // Empty block keeps its buckets, extracted nodes keep their memory
+    auto& block = m_blocks.top();
+    while (!block.empty()) {
+        auto& variable = m_freeVariables.emplace_back(block.extract(block.begin()));
+        variable.mapped() = Symbol{ Symbol::ValueCategory::Lvalue };
+    }
+
+    m_freeBlocks.emplace_back(std::move(block));
+    m_blocks.pop();
+}
+
+app::Symbol* app::Evaluator::findNamed(const std::string_view name)
+{
+    // Scoping is lexical: functions see blocks of their own frame and the top level block,
+    // never the blocks of their callers
+    for (auto index = m_blocks.size(); index > m_blockBase; --index) {
+        auto& block = m_blocks[index - 1];
+        if (const auto it = block.find(name); it != block.end()) {
+            return &it->second;
+        }
+    }
+
+    if (m_blockBase != 0) {
+        auto& block = m_blocks[0];
+        if (const auto it = block.find(name); it != block.end()) {
+            return &it->second;
+        }
+    }
+
+    return nullptr;
+}
+
+app::Symbol& app::Evaluator::declareNamed(const std::string_view name, Symbol value)
+{
+    auto& block = m_blocks.top();
+
+    if (m_freeVariables.empty()) {
+        return block.try_emplace(name, std::move(value)).first->second;
+    }
+
+    auto variable = std::move(m_freeVariables.back());
+    m_freeVariables.pop_back();
+
+    variable.key() = name;
+    variable.mapped() = std::move(value);
+    return block.insert(std::move(variable)).position->second;
+}
+
+void app::Evaluator::pushFunctionArgument(const Symbol& argument)
+{
+    m_locals.emplace_back(argument);
+}
+
+void app::Evaluator::pushFunctionArgument(Symbol&& argument)
+{
+    m_locals.emplace_back(std::move(argument));
+}
+
+void app::Evaluator::pushFrame(const size_t argumentCount)
+{
+    if (argumentCount > m_locals.size() - m_frameBase) {
+        throw std::runtime_error{ "Unable to create frame. Not enough function arguments" };
+    }
+
+    m_frames.push(Frame{ m_frameBase, m_blockBase });
+    m_frameBase = m_locals.size() - argumentCount;
+    m_blockBase = m_blocks.size();
+    m_argumentCount = argumentCount;
+    m_parameterIndex = 0;
+}
+
+void app::Evaluator::popFrame()
+{
+    if (m_frames.empty()) {
+        throw std::runtime_error{ "Unable to delete frame. Call stack is empty" };
+    }
+
+    // Drops the locals together with the arguments
+    m_locals.resize(m_frameBase, Symbol{ Symbol::ValueCategory::Lvalue });
+    m_frameBase = m_frames.top().base;
+    m_blockBase = m_frames.top().blockBase;
+    m_frames.pop();
+}
+
+bool app::Evaluator::tailCall(const size_t argumentCount)
+{
+    std::optional<Pointer> address;
+    visitSymbol([&address](const Symbol& symbol) {
+        symbol.unref().visit([&address](auto && arg) {
+            using T = std::decay_t<decltype(arg)>;
+
+            if constexpr (std::is_same_v<T, ScriptFunction>) {
+                address = arg.address;
+            }
+        });
+    }, m_stack.top());
+
+    // Parameters are declared at the callee address: name, DECLARG or DECLARGREF
+    const auto& byteCode = *m_byteCode;
+    const auto isValueParameter = [&byteCode, &address](const size_t index) {
+        const auto position = *address + 2 * index + 1;
+        const auto* op = position < byteCode.size() ? std::get_if<OpCode>(&byteCode[position]) : nullptr;
+        return op != nullptr && *op == OpCode::DECLARG;
+    };
+
+    if (!address.has_value() || !reuseFrame(argumentCount, isValueParameter)) {
+        return false;
+    }
+
+    m_stack.pop();
+    m_stack.pop();
+
+    m_position = *address;
+    return true;
+}
+
+bool app::Evaluator::isFrameVariable(const Symbol& symbol, const size_t end) const
+{
+    // Slots of a deque are not contiguous, so they are compared one by one
+    for (auto i = m_frameBase; i < end; ++i) {
+        if (&m_locals[i] == &symbol) {
             return true;
         }
     }
@@ -144,81 +697,232 @@ bool app::Evaluator::hasVariable(const std::string_view name) const
     return false;
 }
 
+void app::Evaluator::replaceFrame(const size_t argumentCount)
+{
+    // Return pointer of the current frame is kept, so the callee returns to our caller
+    const auto arguments = m_locals.end() - static_cast<std::ptrdiff_t>(argumentCount);
+    std::move(arguments, m_locals.end(), m_locals.begin() + static_cast<std::ptrdiff_t>(m_frameBase));
+    m_locals.resize(m_frameBase + argumentCount, Symbol{ Symbol::ValueCategory::Lvalue });
+    m_argumentCount = argumentCount;
+    m_parameterIndex = 0;
+}
+
+app::Symbol& app::Evaluator::nextArgument()
+{
+    if (m_parameterIndex >= m_argumentCount) {
+        throw std::runtime_error{ "Unable to read function arguments. Not enough arguments passed" };
+    }
+
+    return m_locals[m_frameBase + m_parameterIndex++];
+}
+
+void app::Evaluator::bindArgument(Symbol& variable, Symbol& argument, const bool isReference)
+{
+    if (!isReference) {
+        variable.assign(std::move(argument));
+        return;
+    }
+
+    if (argument.getValueCategory() != Symbol::ValueCategory::Lvalue) {
+        throw std::runtime_error{ "Unable to get reference of rvalue" };
+    }
+
+    // Argument slots can be reused by the following parameters, never reference them
+    if (argument.getType() == Symbol::Type::Reference) {
+        variable = Symbol{ &argument };
+    }
+    else {
+        variable.assign(std::move(argument));
+    }
+}
+
+void app::Evaluator::declareArgument(const std::string_view name, const bool isReference)
+{
+    auto& argument = nextArgument();
+
+    declareVariable(name);
+    bindArgument(findVariable(name), argument, isReference);
+}
+
+void app::Evaluator::declareArgument(const LocalSlot slot, const bool isReference)
+{
+    auto& argument = nextArgument();
+    const auto index = m_frameBase + slot.index;
+
+    // Parameters get the first slots of the frame, so the argument is already in place
+    if (index < m_locals.size() && &argument == &m_locals[index]) {
+        if (isReference) {
+            if (argument.getValueCategory() != Symbol::ValueCategory::Lvalue) {
+                throw std::runtime_error{ "Unable to get reference of rvalue" };
+            }
+        }
+        else if (argument.getType() == Symbol::Type::Reference) {
+            argument = Symbol{ argument.unref(), Symbol::ValueCategory::Lvalue };
+        }
+        else {
+            argument.setValueCategory(Symbol::ValueCategory::Lvalue);
+        }
+        return;
+    }
+
+    declareVariable(slot);
+    bindArgument(findVariable(slot), argument, isReference);
+}
+
+void app::Evaluator::declareArgument(const GlobalSlot slot, const bool isReference)
+{
+    auto& argument = nextArgument();
+
+    declareVariable(slot);
+    bindArgument(findVariable(slot), argument, isReference);
+}
+
+app::Symbol app::Evaluator::getMember(const CoreObjectPtr& object, const std::string_view name,
+    MemberCache& cache, const bool isCalled)
+{
+    const auto& member = object->findMember(name, cache);
+    if (member.method == nullptr) {
+        return Symbol{ &object->getField(member.index) };
+    }
+
+    if (isCalled) {
+        m_methodObject = object;
+        return *member.method;
+    }
+
+    auto bound = CoreFunctionPtr{};
+    member.method->visit([&object, &bound](auto && arg) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(arg)>, CoreFunctionPtr>) {
+            bound = makeRef<BoundCoreMethod>(object, arg);
+        }
+    });
+
+    return Symbol{ bound, Symbol::ValueCategory::Rvalue };
+}
+
+void app::Evaluator::setMethodObject(CoreObjectPtr object)
+{
+    m_methodObject = std::move(object);
+}
+
+app::CoreObjectPtr app::Evaluator::takeMethodObject()
+{
+    return std::move(m_methodObject);
+}
+
+void app::Evaluator::beginFunctionArguments(const size_t argumentCount)
+{
+    if (argumentCount > m_locals.size() - m_frameBase) {
+        throw std::runtime_error{ "Unable to read function arguments. Not enough arguments passed" };
+    }
+
+    m_argumentsEnd = m_locals.size();
+    m_argumentsStart = m_argumentsEnd - argumentCount;
+    m_argumentsBegin = m_argumentsStart;
+}
+
 app::Symbol app::Evaluator::popFunctionArgument()
 {
-    if (m_argumentsStack.empty()) {
+    if (!hasFunctionArguments()) {
         throw std::runtime_error{ "Unable to read function arguments. Arguments stack is empty" };
     }
 
-    auto argument = m_argumentsStack.front();
-    m_argumentsStack.pop_front();
-
-    return argument;
+    return std::move(m_locals[m_argumentsBegin++]);
 }
 
 bool app::Evaluator::hasFunctionArguments() const
 {
-    return !m_argumentsStack.empty();
+    return m_argumentsBegin < m_argumentsEnd;
 }
 
 size_t app::Evaluator::getFunctionArgumentCount() const
 {
-    return m_argumentsStack.size();
+    return m_argumentsEnd - m_argumentsBegin;
 }
 
-void app::Evaluator::handleDecl(const OpCode op)
+void app::Evaluator::clearFunctionArguments()
 {
-    if (m_stack.empty()) {
-        throw std::runtime_error{ "Unable to read " + toString(op) + " arguments. Stack is empty" };
-    }
+    m_locals.resize(m_argumentsStart, Symbol{ Symbol::ValueCategory::Lvalue });
+    m_argumentsBegin = m_argumentsStart;
+    m_argumentsEnd = m_argumentsStart;
+}
 
-    const auto symbolName = std::get_if<std::string_view>(&m_stack.back());
-    if (symbolName == nullptr) {
-        throw std::runtime_error{ "Unable to read " + toString(op) + " arguments. Invalid argument type" };
+size_t app::Evaluator::readArgumentCount(const StackItem& item) const
+{
+    const auto* count = std::get_if<Symbol>(&item);
+    if (count == nullptr || count->getType() != Symbol::Type::Number) {
+        throw std::runtime_error{ "Unable to read CALL arguments. Invalid argument count" };
     }
 
-    if (op == OpCode::DECLVAR) {
-        const auto[it, success] = m_blocks.back().try_emplace(*symbolName, Symbol::ValueCategory::Lvalue);
-        if (!success) {
-            throw std::runtime_error{ "Variable with name " + std::string{ *symbolName } + "already exists" };
+    return static_cast<size_t>(count->getValue().asNumber());
+}
+
+template<bool Checked>
+void app::Evaluator::handleDecl(const OpCode op)
+{
+    if constexpr (Checked) {
+        if (m_stack.empty()) {
+            throw std::runtime_error{ "Unable to read " + toString(op) + " arguments. Stack is empty" };
         }
     }
-    else if (op == OpCode::DECLFUN) {
-        if (m_pointerStack.empty()) {
-            throw std::runtime_error{ "Unable to read " + toString(op) + " arguments. Pointer stack is empty" };
+
+    std::visit([this, op](auto && arg) {
+        using T = std::decay_t<decltype(arg)>;
+
+        if constexpr (details::is_any_of_v<T, std::string_view, LocalSlot, GlobalSlot>) {
+            if (op == OpCode::DECLVAR) {
+                declareVariable(arg);
+                return;
+            }
         }
 
-        const auto pointer = m_pointerStack.top();
-        m_pointerStack.pop();
+        if constexpr (details::is_any_of_v<T, std::string_view, GlobalSlot>) {
+            if (op == OpCode::DECLFUN) {
+                if constexpr (Checked) {
+                    if (m_pointerStack.empty()) {
+                        throw std::runtime_error{ "Unable to read " + toString(op) + " arguments. Pointer stack is empty" };
+                    }
+                }
 
-        const auto[it, success] = m_blocks.back().try_emplace(*symbolName,
-            ScriptFunction{ pointer }, Symbol::ValueCategory::Lvalue);
+                const auto pointer = m_pointerStack.top();
+                m_pointerStack.pop();
 
-        if (!success) {
-            throw std::runtime_error{ "Function with name " + std::string{ *symbolName } +"already exists" };
+                declareFunction(arg, pointer);
+                return;
+            }
         }
-    }
 
-    m_stack.pop_back();
+        throw std::runtime_error{ "Unable to read " + toString(op) + " arguments. Invalid argument type" };
+    }, m_stack.top());
+
+    m_stack.pop();
 
     ++m_position;
 }
 
+template<bool Checked>
 void app::Evaluator::handleAssign(const OpCode op)
 {
-    if (m_stack.size() < 2) {
-        throw std::runtime_error{ "Unable to read " + toString(op) + " arguments. Stack size is less then 2" };
+    if constexpr (Checked) {
+        if (m_stack.size() < 2) {
+            throw std::runtime_error{ "Unable to read " + toString(op) + " arguments. Stack size is less then 2" };
+        }
     }
 
-    auto variableValue = m_stack.back();
-    m_stack.pop_back();
+    auto& variableValue = m_stack.top();
+    auto& variable = m_stack[m_stack.size() - 2];
 
-    auto variable = m_stack.back();
-    m_stack.pop_back();
+    // Values on the stack are temporaries and can be moved, variables are copied
+    const auto isTemporary = std::holds_alternative<Symbol>(variableValue);
 
-    visitSymbolsPair([op](Symbol& argLeft, Symbol& argRight) {
+    visitSymbolsPair([op, isTemporary](Symbol& argLeft, Symbol& argRight) {
         if (op == OpCode::ASSIGN) {
-            argLeft.assign(argRight);
+            if (isTemporary) {
+                argLeft.assign(std::move(argRight));
+            }
+            else {
+                argLeft.assign(argRight);
+            }
         }
         else if (op == OpCode::ASSIGNREF) {
             if (argRight.getValueCategory() != Symbol::ValueCategory::Lvalue) {
@@ -227,45 +931,71 @@ void app::Evaluator::handleAssign(const OpCode op)
 
             argLeft = Symbol{ &argRight };
         }
+        else if (op == OpCode::INCVAR) {
+            argLeft.assign(argLeft.unref().operationBinaryMath(argRight.unref(), OpCode::ADD));
+        }
     }, variable, variableValue);
 
+    m_stack.pop();
+    m_stack.pop();
+
     ++m_position;
 }
 
+template<bool Checked>
 void app::Evaluator::handleDeref()
 {
-    if (m_stack.empty()) {
-        throw std::runtime_error{ "Unable to read DEREF arguments. Stack is empty" };
+    if constexpr (Checked) {
+        if (m_stack.empty()) {
+            throw std::runtime_error{ "Unable to read DEREF arguments. Stack is empty" };
+        }
     }
 
-    auto value = m_stack.back();
-    m_stack.pop_back();
+    auto& value = m_stack.top();
 
-    visitSymbol([this](const Symbol& symbol) {
-        m_stack.emplace_back(Symbol{ symbol.unref(), Symbol::ValueCategory::Rvalue });
-    }, value);
+    if (auto* symbol = std::get_if<Symbol>(&value);
+        symbol != nullptr && symbol->getType() != Symbol::Type::Reference)
+    {
+        symbol->setValueCategory(Symbol::ValueCategory::Rvalue);
+    }
+    else {
+        visitSymbol([&value](const Symbol& symbol) {
+            value = Symbol{ symbol.unref(), Symbol::ValueCategory::Rvalue };
+        }, value);
+    }
 
     ++m_position;
 }
 
-void app::Evaluator::handleStructRef()
+template<bool Checked>
+void app::Evaluator::handleStructRef(const bool isCalled)
 {
-    if (m_stack.size() < 2) {
-        throw std::runtime_error{ "Unable to read STRUCTREF arguments. Stack size is less then 2" };
+    pushMember<Checked>(isCalled);
+
+    ++m_position;
+}
+
+template<bool Checked>
+void app::Evaluator::pushMember(const bool isCalled)
+{
+    if constexpr (Checked) {
+        if (m_stack.size() < 2) {
+            throw std::runtime_error{ "Unable to read STRUCTREF arguments. Stack size is less then 2" };
+        }
     }
 
-    const auto memberName = std::move(m_stack.back());
-    m_stack.pop_back();
+    const auto memberName = std::move(m_stack.top());
+    m_stack.pop();
 
     if (!std::holds_alternative<std::string_view>(memberName)) {
         throw std::runtime_error{ "Unable to read STRUCTREF member name argument" };
     }
 
-    auto object = m_stack.back();
-    m_stack.pop_back();
+    auto object = std::move(m_stack.top());
+    m_stack.pop();
 
-    visitSymbol([this, &memberName](const Symbol & symbol) {
-        symbol.unref().visit([this, &memberName](auto && arg) {
+    visitSymbol([this, &memberName, isCalled](const Symbol & symbol) {
+        symbol.unref().visit([this, &memberName, isCalled](auto && arg) {
             using T = std::decay_t<decltype(arg)>;
 
             if constexpr (std::is_same_v<T, CoreObjectPtr>) {
@@ -274,79 +1004,154 @@ void app::Evaluator::handleStructRef()
                 }
 
                 //TODO: check original core object lifetime after assignment
-                const auto name = std::string{ std::get<std::string_view>(memberName) };
-                auto member = arg->getMember(name);
-                m_stack.emplace_back(member);
+                m_stack.emplace(getMember(arg, std::get<std::string_view>(memberName), m_memberCaches[m_position], isCalled));
             }
             else {
                 throw std::runtime_error{ "Unable to access member of non core object" };
             }
         });
     }, object);
-
-    ++m_position;
 }
 
+template<bool Checked>
 void app::Evaluator::handlePop()
 {
-    if (!m_stack.empty()) {
-        m_stack.pop_back();
+    if (!Checked || !m_stack.empty()) {
+        m_stack.pop();
     }
 
     ++m_position;
 }
 
+template<bool Checked>
 void app::Evaluator::handleUnaryOperator(const OpCode op)
 {
-    if (m_stack.empty()) {
-        throw std::runtime_error{ "Unable to read " + toString(op) + " argument. Stack is empty" };
+    if constexpr (Checked) {
+        if (m_stack.empty()) {
+            throw std::runtime_error{ "Unable to read " + toString(op) + " argument. Stack is empty" };
+        }
     }
 
-    auto value = m_stack.back();
-    m_stack.pop_back();
+    auto& value = m_stack.top();
 
-    visitSymbol([this, op](const Symbol& arg) {
-        m_stack.emplace_back(arg.unref().operationUnary(op));
+    visitSymbol([&value, op](const Symbol& arg) {
+        value = arg.unref().operationUnary(op);
     }, value);
 
     ++m_position;
 }
 
-void app::Evaluator::handleBinaryOperator(const OpCode op)
+template<bool Checked>
+void app::Evaluator::handleBinaryOperator(const OpCode op, uint8_t& code)
 {
-    if (m_stack.size() < 2) {
-        throw std::runtime_error{ "Unable to read " + toString(op) + " arguments. Stack size is less then 2" };
+    if constexpr (Checked) {
+        if (m_stack.size() < 2) {
+            throw std::runtime_error{ "Unable to read " + toString(op) + " arguments. Stack size is less then 2" };
+        }
     }
 
-    auto valueRight = m_stack.back();
-    m_stack.pop_back();
+    auto& valueRight = m_stack.top();
+    auto& valueLeft = m_stack[m_stack.size() - 2];
 
-    auto valueLeft = m_stack.back();
-    m_stack.pop_back();
+    // Result replaces the left operand
+    visitSymbolsPair([this, &valueLeft, &code, op](const Symbol& symbolLeft, const Symbol& symbolRight) {
+        const auto& left = symbolLeft.unref();
+        const auto& right = symbolRight.unref();
+
+        if (!m_dequickened[m_position]) {
+            code = details::quicken(op, left.getValue(), right.getValue());
+        }
 
-    visitSymbolsPair([this, op](const Symbol& symbolLeft, const Symbol& symbolRight) {
         if (isBinaryMathOp(op)) {
-            m_stack.emplace_back(symbolLeft.unref().operationBinaryMath(symbolRight.unref(), op));
+            valueLeft = left.operationBinaryMath(right, op);
         }
         else if (isLogicOp(op)) {
-            m_stack.emplace_back(symbolLeft.unref().operationLogic(symbolRight.unref(), op));
+            valueLeft = left.operationLogic(right, op);
         }
         else if (isComparisonOp(op)) {
-            m_stack.emplace_back(symbolLeft.unref().operationCompare(symbolRight.unref(), op));
+            valueLeft = left.operationCompare(right, op);
         }
     }, valueLeft, valueRight);
 
+    m_stack.pop();
+
     ++m_position;
 }
 
+template<bool Checked, app::OpCode Op>
+void app::Evaluator::handleNumberOperator(uint8_t& code)
+{
+    if (!Checked || m_stack.size() >= 2) {
+        auto& valueLeft = m_stack[m_stack.size() - 2];
+        const auto& left = resolveSymbol(valueLeft).unref().getValue();
+        const auto& right = resolveSymbol(m_stack.top()).unref().getValue();
+
+        if (left.isNumber() && right.isNumber()) {
+            valueLeft = details::calculate<Op>(left.asNumber(), right.asNumber());
+            m_stack.pop();
+
+            ++m_position;
+            return;
+        }
+    }
+
+    dequicken(code, Op);
+    handleBinaryOperator<Checked>(Op, code);
+}
+
+template<bool Checked>
+void app::Evaluator::handleStringConcatenation(uint8_t& code)
+{
+    if (!Checked || m_stack.size() >= 2) {
+        auto& valueLeft = m_stack[m_stack.size() - 2];
+        const auto& left = resolveSymbol(valueLeft).unref();
+        const auto& right = resolveSymbol(m_stack.top()).unref();
+
+        if (left.getValue().isString() && right.getValue().isString()) {
+            valueLeft = Symbol{ Value::concatenate(left.getValue(), right.getValue()), Symbol::ValueCategory::Rvalue };
+            m_stack.pop();
+
+            ++m_position;
+            return;
+        }
+    }
+
+    dequicken(code, OpCode::ADD);
+    handleBinaryOperator<Checked>(OpCode::ADD, code);
+}
+
+void app::Evaluator::dequicken(uint8_t& code, const OpCode op)
+{
+    // Instructions which see different types stay generic
+    code = static_cast<uint8_t>(op);
+    m_dequickened[m_position] = true;
+}
+
+app::Symbol& app::Evaluator::resolveSymbol(StackItem& item)
+{
+    if (auto* symbol = std::get_if<Symbol>(&item); symbol != nullptr) {
+        return *symbol;
+    }
+
+    Symbol* result = nullptr;
+    visitSymbol([&result](Symbol& symbol) {
+        result = &symbol;
+    }, item);
+
+    return *result;
+}
+
+template<bool Checked>
 void app::Evaluator::handleControl(const OpCode op)
 {
     const auto opIf = [this]() {
-        if (m_stack.empty()) {
-            throw std::runtime_error{ "Unable to read IF arguments. Stack is empty" };
-        }
-        if (m_pointerStack.size() < 2) {
-            throw std::runtime_error{ "Unable to read IF arguments. Pointer stack size is less then 2" };
+        if constexpr (Checked) {
+            if (m_stack.empty()) {
+                throw std::runtime_error{ "Unable to read IF arguments. Stack is empty" };
+            }
+            if (m_pointerStack.size() < 2) {
+                throw std::runtime_error{ "Unable to read IF arguments. Pointer stack size is less then 2" };
+            }
         }
 
         auto value = false;
@@ -365,8 +1170,8 @@ void app::Evaluator::handleControl(const OpCode op)
 
                 throw std::runtime_error{ "Unable to read IF arguments. Invalid argument type" };
             });
-        }, m_stack.back());
-        m_stack.pop_back();
+        }, m_stack.top());
+        m_stack.pop();
 
         const auto falsePointer = m_pointerStack.top();
         m_pointerStack.pop();
@@ -378,12 +1183,14 @@ void app::Evaluator::handleControl(const OpCode op)
     };
 
     const auto opJmp = [this](const OpCode op) {
-        if (m_pointerStack.empty()) {
-            throw std::runtime_error{ "Unable to read " + toString(op) + " arguments. Pointer stack is empty" };
+        if constexpr (Checked) {
+            if (m_pointerStack.empty()) {
+                throw std::runtime_error{ "Unable to read " + toString(op) + " arguments. Pointer stack is empty" };
+            }
         }
 
         if (op == OpCode::RET) {
-            m_argumentsStack.clear();
+            popFrame();
         }
 
         const auto pointer = m_pointerStack.top();
@@ -393,25 +1200,39 @@ void app::Evaluator::handleControl(const OpCode op)
     };
 
     const auto opCall = [this]() {
-        if (m_stack.empty()) {
-            throw std::runtime_error{ "Unable to read CALL arguments. Stack is empty" };
+        if constexpr (Checked) {
+            if (m_stack.size() < 2) {
+                throw std::runtime_error{ "Unable to read CALL arguments. Stack size is less then 2" };
+            }
         }
 
-        auto value = m_stack.back();
-        m_stack.pop_back();
+        auto value = std::move(m_stack.top());
+        m_stack.pop();
 
-        visitSymbol([this](const Symbol & symbol) {
-            symbol.unref().visit([this](auto && arg) {
+        const auto argumentCount = readArgumentCount(m_stack.top());
+        m_stack.pop();
+
+        visitSymbol([this, argumentCount](const Symbol & symbol) {
+            symbol.unref().visit([this, argumentCount](auto && arg) {
                 using T = std::decay_t<decltype(arg)>;
 
                 if constexpr (std::is_same_v<T, ScriptFunction>) {
                     m_pointerStack.push(m_position + 1);
+                    pushFrame(argumentCount);
 
                     m_position = arg.address;
                 }
                 else if constexpr (std::is_same_v<T, CoreFunctionPtr>) {
+                    const auto stackSize = m_stack.size();
+
+                    beginFunctionArguments(argumentCount);
                     arg->call(*this);
-                    m_argumentsStack.clear();
+                    clearFunctionArguments();
+
+                    // Calls always yield a value
+                    if (m_stack.size() == stackSize) {
+                        m_stack.emplace(Symbol{ Symbol::ValueCategory::Rvalue });
+                    }
 
                     ++m_position;
                 }
@@ -422,6 +1243,23 @@ void app::Evaluator::handleControl(const OpCode op)
         }, value);
     };
 
+    const auto opTailCall = [this, &opCall]() {
+        if constexpr (Checked) {
+            if (m_stack.size() < 2) {
+                throw std::runtime_error{ "Unable to read TAILCALL arguments. Stack size is less then 2" };
+            }
+        }
+
+        const auto argumentCount = readArgumentCount(m_stack[m_stack.size() - 2]);
+        if (argumentCount > m_locals.size() - m_frameBase) {
+            throw std::runtime_error{ "Unable to read TAILCALL arguments. Not enough arguments passed" };
+        }
+
+        if (!tailCall(argumentCount)) {
+            opCall();
+        }
+    };
+
     switch (op) {
     case OpCode::IF:
         opIf();
@@ -433,59 +1271,171 @@ void app::Evaluator::handleControl(const OpCode op)
     case OpCode::CALL:
         opCall();
         return;
+    case OpCode::CALL_MEMBER:
+        pushMember<Checked>(true);
+        opCall();
+        return;
+    case OpCode::TAILCALL:
+        opTailCall();
+        return;
     default:
         return;
     }
 }
 
+template<bool Checked>
+void app::Evaluator::handleCompareJump(uint8_t& code)
+{
+    if constexpr (Checked) {
+        if (m_stack.size() < 2) {
+            throw std::runtime_error{ "Unable to read LT_JMP arguments. Stack size is less then 2" };
+        }
+        if (m_pointerStack.size() < 2) {
+            throw std::runtime_error{ "Unable to read LT_JMP arguments. Pointer stack size is less then 2" };
+        }
+    }
+
+    auto& valueRight = m_stack.top();
+    auto& valueLeft = m_stack[m_stack.size() - 2];
+
+    auto value = false;
+    visitSymbolsPair([this, &value, &code](const Symbol& symbolLeft, const Symbol& symbolRight) {
+        const auto& left = symbolLeft.unref();
+        const auto& right = symbolRight.unref();
+
+        if (!m_dequickened[m_position]) {
+            code = details::quicken(OpCode::LT_JMP, left.getValue(), right.getValue());
+        }
+
+        left.operationCompare(right, OpCode::LT).visit([&value](auto && arg) {
+            using T = std::decay_t<decltype(arg)>;
+
+            if constexpr (std::is_same_v<T, bool>) {
+                value = arg;
+            }
+        });
+    }, valueLeft, valueRight);
+
+    m_stack.pop();
+    m_stack.pop();
+
+    jumpIf(value);
+}
+
+template<bool Checked>
+void app::Evaluator::handleNumberCompareJump(uint8_t& code)
+{
+    if (!Checked || (m_stack.size() >= 2 && m_pointerStack.size() >= 2)) {
+        const auto& left = resolveSymbol(m_stack[m_stack.size() - 2]).unref().getValue();
+        const auto& right = resolveSymbol(m_stack.top()).unref().getValue();
+
+        if (left.isNumber() && right.isNumber()) {
+            const auto value = left.asNumber() < right.asNumber();
+
+            m_stack.pop();
+            m_stack.pop();
+
+            jumpIf(value);
+            return;
+        }
+    }
+
+    dequicken(code, OpCode::LT_JMP);
+    handleCompareJump<Checked>(code);
+}
+
+void app::Evaluator::jumpIf(const bool value)
+{
+    const auto falsePointer = m_pointerStack.top();
+    m_pointerStack.pop();
+
+    const auto truePointer = m_pointerStack.top();
+    m_pointerStack.pop();
+
+    m_position = value ? truePointer : falsePointer;
+}
+
+template<bool Checked>
 void app::Evaluator::handleArguments(const OpCode op)
 {
     if (op == OpCode::PUSHARG) {
-        if (m_stack.empty()) {
-            throw std::runtime_error{ "Unable to read PUSHARG arguments. Stack is empty" };
+        if constexpr (Checked) {
+            if (m_stack.empty()) {
+                throw std::runtime_error{ "Unable to read PUSHARG arguments. Stack is empty" };
+            }
         }
 
-        auto variable = m_stack.back();
-        m_stack.pop_back();
+        auto variable = std::move(m_stack.top());
+        m_stack.pop();
 
         std::visit([this](auto && arg) {
             using T = std::decay_t<decltype(arg)>;
 
-            if constexpr (std::is_same_v<T, std::string_view>) {
-                m_argumentsStack.emplace_back(&findVariable(arg));
+            if constexpr (details::is_any_of_v<T, std::string_view, LocalSlot, GlobalSlot>) {
+                m_locals.emplace_back(&findVariable(arg));
             }
             else {
-                m_argumentsStack.emplace_back(arg);
+                m_locals.emplace_back(std::move(arg));
             }
         }, variable);
     }
-    else if (op == OpCode::POPARG) {
-        if (m_argumentsStack.empty()) {
-            throw std::runtime_error{ "Unable to read POPARG arguments. Arguments stack is empty" };
+    else {
+        if constexpr (Checked) {
+            if (m_stack.empty()) {
+                throw std::runtime_error{ "Unable to read " + toString(op) + " arguments. Stack is empty" };
+            }
         }
 
-        m_stack.emplace_back(popFunctionArgument());
+        std::visit([this, op](auto && arg) {
+            using T = std::decay_t<decltype(arg)>;
+
+            if constexpr (details::is_any_of_v<T, std::string_view, LocalSlot, GlobalSlot>) {
+                declareArgument(arg, op == OpCode::DECLARGREF);
+            }
+            else {
+                throw std::runtime_error{ "Unable to read " + toString(op) + " arguments. Invalid argument type" };
+            }
+        }, m_stack.top());
+        m_stack.pop();
     }
 
     ++m_position;
 }
 
+template<bool Checked>
 void app::Evaluator::handleBlocks(const OpCode op)
 {
     if (op == OpCode::DEFBLOCK) {
-        m_blocks.emplace_back();
+        pushBlock();
     }
     else if (op == OpCode::DELBLOCK) {
-        if (m_blocks.size() <= 1) {
-            throw std::runtime_error{ "Unable to delete scope block" };
+        if constexpr (Checked) {
+            popBlock();
+        }
+        else {
+            releaseBlock();
         }
-
-        m_blocks.pop_back();
     }
 
     ++m_position;
 }
 
+void app::Evaluator::trace(const ByteCodeItem& item, const size_t step)
+{
+    if (m_loggingEnabled) {
+        printf("\n== step: %zu | position: %zu ==\n", step, m_position);
+        printState(true);
+    }
+
+    if (m_profiler != nullptr) {
+        m_profiler->record(item);
+    }
+
+    if (m_loggingEnabled && std::holds_alternative<OpCode>(item)) {
+        printf("[OP] %s\n", toString(std::get<OpCode>(item)).c_str());
+    }
+}
+
 void app::Evaluator::printState(const bool showVariables)
 {
     if (m_stack.empty()) {
@@ -501,6 +1451,12 @@ void app::Evaluator::printState(const bool showVariables)
             if constexpr (std::is_same_v<T, std::string_view>) {
                 printf("%s", std::string{ arg }.c_str());
             }
+            else if constexpr (std::is_same_v<T, LocalSlot>) {
+                printf("local: %zu", static_cast<size_t>(arg.index));
+            }
+            else if constexpr (std::is_same_v<T, GlobalSlot>) {
+                printf("global: %zu", static_cast<size_t>(arg.index));
+            }
             else {
                 printf("%s", arg.getValueCategory() == Symbol::ValueCategory::Lvalue ? "lvalue " : "rvalue ");
                 arg.print();
@@ -521,16 +1477,18 @@ void app::Evaluator::printState(const bool showVariables)
             printf("\n");
         }
 
-        if (m_argumentsStack.empty()) {
-            printf("[arguments stack is empty]\n");
+        for (size_t i = 0; i < m_globals.size(); ++i) {
+            printf("\tglobal %zu: ", i);
+            m_globals[i].print();
+            printf("\n");
         }
-        else {
-            printf("[arguments stack:]\n");
-            for (size_t i = 0; i < m_argumentsStack.size(); ++i) {
-                printf("[%zu] ", i);
-                m_argumentsStack[i].print();
-                printf("\n");
-            }
+
+        for (size_t i = m_frameBase; i < m_locals.size(); ++i) {
+            printf("\tlocal %zu: ", i - m_frameBase);
+            m_locals[i].print();
+            printf("\n");
         }
+
+        printf("[arguments: %zu]\n", m_argumentCount);
     }
 }
@@ -0,0 +1,903 @@
+#include "JitCompiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+
+// Native code follows the System V calling convention of x86-64
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)) && !defined(USL_NO_JIT)
+#define USL_JIT
+#include <sys/mman.h>
+#endif
+
+static_assert(sizeof(app::Symbol) == 16, "Native code expects symbol value and category in 16 bytes");
+
+namespace details
+{
+    enum Register : uint8_t
+    {
+        RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+        R8, R9, R10, R11, R12, R13, R14, R15
+    };
+
+    enum Xmm : uint8_t
+    {
+        XMM0,
+        XMM1
+    };
+
+    enum Condition : uint8_t
+    {
+        AboveEqual = 0x3,
+        Equal = 0x4,
+        NotEqual = 0x5,
+        Above = 0x7,
+        Parity = 0xA,
+        NoParity = 0xB
+    };
+
+    enum SseOp : uint8_t
+    {
+        ADDSD = 0x58,
+        MULSD = 0x59,
+        SUBSD = 0x5C,
+        DIVSD = 0x5E
+    };
+
+    // Symbol layout: value bits, then value category
+    constexpr int32_t SYMBOL_SIZE = 16;
+    constexpr int32_t CATEGORY_OFFSET = 8;
+
+    // Encoder of the few x86-64 instructions used by the templates.
+    // Memory operands are always [base + disp32]
+    class Assembler final
+    {
+    public:
+        using Label = size_t;
+
+        Label createLabel()
+        {
+            m_labels.push_back(UNBOUND);
+            return m_labels.size() - 1;
+        }
+
+        void bind(const Label label)
+        {
+            m_labels[label] = m_code.size();
+        }
+
+        void push(const Register r)
+        {
+            rex(false, 0, r);
+            byte(0x50 | (r & 7));
+        }
+
+        void pop(const Register r)
+        {
+            rex(false, 0, r);
+            byte(0x58 | (r & 7));
+        }
+
+        void mov(const Register dst, const uint64_t imm)
+        {
+            rex(true, 0, dst);
+            byte(0xB8 | (dst & 7));
+            bytes(imm, 8);
+        }
+
+        void mov(const Register dst, const Register src)
+        {
+            rex(true, src, dst);
+            byte(0x89);
+            modrm(src, dst);
+        }
+
+        void load(const Register dst, const Register base, const int32_t disp)
+        {
+            rex(true, dst, base);
+            byte(0x8B);
+            memory(dst, base, disp);
+        }
+
+        void store(const Register base, const int32_t disp, const Register src)
+        {
+            rex(true, src, base);
+            byte(0x89);
+            memory(src, base, disp);
+        }
+
+        void store32(const Register base, const int32_t disp, const int32_t imm)
+        {
+            rex(false, 0, base);
+            byte(0xC7);
+            memory(0, base, disp);
+            bytes(static_cast<uint32_t>(imm), 4);
+        }
+
+        void increment(const Register base, const int32_t disp)
+        {
+            rex(true, 0, base);
+            byte(0xFF);
+            memory(0, base, disp);
+        }
+
+        // Flags of left - right
+        void cmp(const Register left, const Register right)
+        {
+            rex(true, right, left);
+            byte(0x39);
+            modrm(right, left);
+        }
+
+        void cmp(const Register left, const int32_t imm)
+        {
+            rex(true, 0, left);
+            byte(0x81);
+            modrm(7, left);
+            bytes(static_cast<uint32_t>(imm), 4);
+        }
+
+        void cmp32(const Register base, const int32_t disp, const int8_t imm)
+        {
+            rex(false, 0, base);
+            byte(0x83);
+            memory(7, base, disp);
+            byte(static_cast<uint8_t>(imm));
+        }
+
+        void test(const Register left, const Register right)
+        {
+            rex(true, right, left);
+            byte(0x85);
+            modrm(right, left);
+        }
+
+        void or64(const Register dst, const Register src)
+        {
+            rex(true, src, dst);
+            byte(0x09);
+            modrm(src, dst);
+        }
+
+        void or32(const Register dst, const Register src)
+        {
+            rex(false, src, dst);
+            byte(0x09);
+            modrm(src, dst);
+        }
+
+        void and32(const Register dst, const Register src)
+        {
+            rex(false, src, dst);
+            byte(0x21);
+            modrm(src, dst);
+        }
+
+        // Low byte registers only, so no REX prefix is needed
+        void set(const Condition condition, const Register dst)
+        {
+            byte(0x0F);
+            byte(0x90 | condition);
+            modrm(0, dst);
+        }
+
+        void movzx8(const Register dst, const Register src)
+        {
+            byte(0x0F);
+            byte(0xB6);
+            modrm(dst, src);
+        }
+
+        void movq(const Xmm dst, const Register src)
+        {
+            byte(0x66);
+            rex(true, dst, src);
+            byte(0x0F);
+            byte(0x6E);
+            modrm(dst, src);
+        }
+
+        void movq(const Register dst, const Xmm src)
+        {
+            byte(0x66);
+            rex(true, src, dst);
+            byte(0x0F);
+            byte(0x7E);
+            modrm(src, dst);
+        }
+
+        void sse(const SseOp op, const Xmm dst, const Xmm src)
+        {
+            byte(0xF2);
+            byte(0x0F);
+            byte(op);
+            modrm(dst, src);
+        }
+
+        // Flags of left - right, parity is set if one of them is NaN
+        void ucomisd(const Xmm left, const Xmm right)
+        {
+            byte(0x66);
+            byte(0x0F);
+            byte(0x2E);
+            modrm(left, right);
+        }
+
+        void addRsp(const int32_t imm)
+        {
+            rex(true, 0, RSP);
+            byte(0x81);
+            modrm(0, RSP);
+            bytes(static_cast<uint32_t>(imm), 4);
+        }
+
+        void subRsp(const int32_t imm)
+        {
+            rex(true, 0, RSP);
+            byte(0x81);
+            modrm(5, RSP);
+            bytes(static_cast<uint32_t>(imm), 4);
+        }
+
+        void call(const Register target)
+        {
+            rex(false, 0, target);
+            byte(0xFF);
+            modrm(2, target);
+        }
+
+        void ret()
+        {
+            byte(0xC3);
+        }
+
+        void jmp(const Label label)
+        {
+            byte(0xE9);
+            fixup(label);
+        }
+
+        void jump(const Condition condition, const Label label)
+        {
+            byte(0x0F);
+            byte(0x80 | condition);
+            fixup(label);
+        }
+
+        std::vector<uint8_t> finish()
+        {
+            for (const auto& [offset, label] : m_fixups) {
+                const auto target = static_cast<int64_t>(m_labels[label]);
+                const auto relative = static_cast<int32_t>(target - static_cast<int64_t>(offset + 4));
+                std::memcpy(&m_code[offset], &relative, sizeof(relative));
+            }
+
+            return std::move(m_code);
+        }
+
+    private:
+        static constexpr size_t UNBOUND = SIZE_MAX;
+
+        void byte(const uint8_t value)
+        {
+            m_code.push_back(value);
+        }
+
+        void bytes(uint64_t value, const size_t count)
+        {
+            for (size_t i = 0; i < count; ++i, value >>= 8) {
+                byte(static_cast<uint8_t>(value & 0xFF));
+            }
+        }
+
+        void rex(const bool wide, const uint8_t reg, const uint8_t rm)
+        {
+            if (wide || reg >= 8 || rm >= 8) {
+                byte(0x40 | (wide ? 0x8 : 0) | ((reg >> 3) << 2) | (rm >> 3));
+            }
+        }
+
+        void modrm(const uint8_t reg, const uint8_t rm)
+        {
+            byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+        }
+
+        void memory(const uint8_t reg, const uint8_t base, const int32_t disp)
+        {
+            byte(0x80 | ((reg & 7) << 3) | (base & 7));
+            if ((base & 7) == RSP) {
+                byte(0x24);
+            }
+            bytes(static_cast<uint32_t>(disp), 4);
+        }
+
+        void fixup(const Label label)
+        {
+            m_fixups.emplace_back(m_code.size(), label);
+            bytes(0, 4);
+        }
+
+        std::vector<uint8_t> m_code;
+        std::vector<size_t> m_labels;
+        std::vector<std::pair<size_t, Label>> m_fixups;
+    };
+
+    // Register assignment of the native code:
+    //  rbx - entry position     r12 - registers of the frame   r13 - instruction counter
+    //  r14 - greatest number    r15 - least boxed value        rbp - least reference
+    //  [rsp + 8 * n] - cached addresses of local and global slots
+    class Translator final
+    {
+        using Kind = app::RegisterOperand::Kind;
+        using Label = Assembler::Label;
+
+    public:
+        Translator(const app::JitRuntime& runtime, const app::RegisterProgram& program,
+            const size_t begin, const size_t end) :
+            m_runtime(runtime), m_program(program), m_begin(begin), m_end(end)
+        {
+        }
+
+        bool translate()
+        {
+            const auto& instructions = m_program.instructions;
+
+            m_entries.assign(1, m_begin);
+            for (auto position = m_begin; position < m_end; ++position) {
+                const auto& instruction = instructions[position];
+
+                // Nested functions are compiled separately
+                if (instruction.op == app::OpCode::DECLFUN) {
+                    return false;
+                }
+
+                // Calls return to the interpreter, loops can be entered from it
+                if ((instruction.op == app::OpCode::CALL || instruction.op == app::OpCode::TAILCALL) && position + 1 < m_end) {
+                    m_entries.push_back(position + 1);
+                }
+                if (instruction.op == app::OpCode::JMP && instruction.a.index > m_begin && instruction.a.index <= position) {
+                    m_entries.push_back(instruction.a.index);
+                }
+
+                for (const auto* operand : { &instruction.a, &instruction.b, &instruction.c }) {
+                    if (isSlot(*operand)) {
+                        m_slots.try_emplace(slotKey(*operand), m_slots.size());
+                    }
+                }
+            }
+
+            for (auto position = m_begin; position < m_end; ++position) {
+                m_labels.push_back(m_assembler.createLabel());
+            }
+            m_epilogue = m_assembler.createLabel();
+
+            std::sort(m_entries.begin(), m_entries.end());
+            m_entries.erase(std::unique(m_entries.begin(), m_entries.end()), m_entries.end());
+
+            emitPrologue();
+            for (auto position = m_begin; position < m_end; ++position) {
+                emitInstruction(position);
+            }
+            exitTo(m_end);
+            emitEpilogue();
+
+            return true;
+        }
+
+        std::vector<uint8_t> finish()
+        {
+            return m_assembler.finish();
+        }
+
+        const std::vector<size_t>& getEntries() const
+        {
+            return m_entries;
+        }
+
+    private:
+        static bool isSlot(const app::RegisterOperand& operand)
+        {
+            return operand.kind == Kind::Local || operand.kind == Kind::Global;
+        }
+
+        static size_t slotKey(const app::RegisterOperand& operand)
+        {
+            return operand.index * 2 + (operand.kind == Kind::Global ? 1 : 0);
+        }
+
+        int32_t frameSize() const
+        {
+            // Keeps the stack aligned to 16 bytes at calls after six pushes
+            const auto size = m_slots.size() * 8;
+            return static_cast<int32_t>(size % 16 == 8 ? size : size + 8);
+        }
+
+        int32_t slotOffset(const app::RegisterOperand& operand) const
+        {
+            return static_cast<int32_t>(m_slots.at(slotKey(operand)) * 8);
+        }
+
+        static int32_t registerOffset(const app::RegisterOperand& operand)
+        {
+            return static_cast<int32_t>(operand.index) * SYMBOL_SIZE;
+        }
+
+        bool isNumberConstant(const app::RegisterOperand& operand) const
+        {
+            return operand.kind == Kind::Constant && m_program.constants[operand.index].getValue().isNumber();
+        }
+
+        bool isNumberSource(const app::RegisterOperand& operand) const
+        {
+            return operand.kind == Kind::Register || isSlot(operand) || isNumberConstant(operand);
+        }
+
+        bool isNumberTarget(const app::RegisterOperand& operand) const
+        {
+            return operand.kind == Kind::None || operand.kind == Kind::Register || isSlot(operand);
+        }
+
+        Label labelOf(const size_t position)
+        {
+            if (position >= m_begin && position < m_end) {
+                return m_labels[position - m_begin];
+            }
+
+            // Jumps out of the function return to the interpreter
+            const auto [it, inserted] = m_exits.try_emplace(position, 0);
+            if (inserted) {
+                it->second = m_assembler.createLabel();
+            }
+            return it->second;
+        }
+
+        void callRuntime(const void* function, const size_t first, const size_t second = 0)
+        {
+            m_assembler.mov(RDI, reinterpret_cast<uint64_t>(m_runtime.context));
+            m_assembler.mov(RSI, first);
+            m_assembler.mov(RDX, second);
+            m_assembler.mov(RAX, reinterpret_cast<uint64_t>(function));
+            m_assembler.call(RAX);
+        }
+
+        void exitTo(const size_t position)
+        {
+            m_assembler.mov(RAX, position);
+            m_assembler.jmp(m_epilogue);
+        }
+
+        void emitPrologue()
+        {
+            auto& as = m_assembler;
+
+            for (const auto r : { RBX, RBP, R12, R13, R14, R15 }) {
+                as.push(r);
+            }
+            as.subRsp(frameSize());
+
+            as.mov(RBX, RDI);
+            as.mov(R13, reinterpret_cast<uint64_t>(m_runtime.instructionCount));
+            as.mov(R14, app::Value::getMaxNumberBits());
+            as.mov(R15, app::Value::getMinCountedBits());
+            as.mov(RBP, app::Value::getMinReferenceBits());
+
+            as.mov(RAX, uint64_t{ 0 });
+            for (size_t i = 0; i < m_slots.size(); ++i) {
+                as.store(RSP, static_cast<int32_t>(i * 8), RAX);
+            }
+
+            m_assembler.mov(RDI, reinterpret_cast<uint64_t>(m_runtime.context));
+            m_assembler.mov(RAX, reinterpret_cast<uint64_t>(m_runtime.registers));
+            m_assembler.call(RAX);
+            as.mov(R12, RAX);
+
+            for (const auto entry : m_entries) {
+                as.cmp(RBX, static_cast<int32_t>(entry));
+                as.jump(Equal, labelOf(entry));
+            }
+            exitTo(app::JitFunction::NOT_ENTERED);
+        }
+
+        void emitEpilogue()
+        {
+            auto& as = m_assembler;
+
+            for (const auto& [position, label] : m_exits) {
+                as.bind(label);
+                exitTo(position);
+            }
+
+            as.bind(m_epilogue);
+            as.addRsp(frameSize());
+            for (const auto r : { R15, R14, R13, R12, RBP, RBX }) {
+                as.pop(r);
+            }
+            as.ret();
+        }
+
+        void emitInstruction(const size_t position)
+        {
+            const auto& instruction = m_program.instructions[position];
+
+            m_assembler.bind(m_labels[position - m_begin]);
+            m_assembler.increment(R13, 0);
+
+            switch (instruction.op) {
+            case app::OpCode::JMP:
+                m_assembler.jmp(labelOf(instruction.a.index));
+                return;
+
+            case app::OpCode::IF:
+                emitIf(position, instruction);
+                return;
+
+            case app::OpCode::RET:
+                emitStep(position);
+                m_assembler.jmp(m_epilogue);
+                return;
+
+            case app::OpCode::ADD:
+            case app::OpCode::SUB:
+            case app::OpCode::MUL:
+            case app::OpCode::DIV:
+            case app::OpCode::EQ:
+            case app::OpCode::NEQ:
+            case app::OpCode::LT:
+            case app::OpCode::LE:
+            case app::OpCode::GT:
+            case app::OpCode::GE:
+                if (isNumberTarget(instruction.a) && isNumberSource(instruction.b) && isNumberSource(instruction.c)) {
+                    emitNumberOperation(position, instruction);
+                    return;
+                }
+                break;
+
+            case app::OpCode::DEREF:
+                if (isNumberTarget(instruction.a) && isNumberSource(instruction.b)) {
+                    emitNumberOperation(position, instruction);
+                    return;
+                }
+                break;
+
+            case app::OpCode::ASSIGN:
+                // Registers are rvalues, so only slots are assigned in place
+                if (isSlot(instruction.a) && isNumberSource(instruction.b)) {
+                    emitNumberOperation(position, instruction);
+                    return;
+                }
+                break;
+
+            default:
+                break;
+            }
+
+            // CALL of a script function continues in the interpreter
+            emitStep(position);
+            m_assembler.cmp(RAX, static_cast<int32_t>(position + 1));
+            m_assembler.jump(NotEqual, m_epilogue);
+        }
+
+        void emitStep(const size_t position)
+        {
+            callRuntime(reinterpret_cast<const void*>(m_runtime.step), position);
+        }
+
+        // Address of the slot in rdx
+        void resolveSlot(const app::RegisterOperand& operand, const Label fail)
+        {
+            auto& as = m_assembler;
+            const auto offset = slotOffset(operand);
+            const auto resolved = as.createLabel();
+
+            as.load(RDX, RSP, offset);
+            as.test(RDX, RDX);
+            as.jump(NotEqual, resolved);
+
+            callRuntime(reinterpret_cast<const void*>(m_runtime.variable), static_cast<size_t>(operand.kind), operand.index);
+            as.test(RAX, RAX);
+            as.jump(Equal, fail);
+            as.store(RSP, offset, RAX);
+
+            as.bind(resolved);
+        }
+
+        void loadBits(const app::RegisterOperand& operand, const Register dst)
+        {
+            if (operand.kind == Kind::Register) {
+                m_assembler.load(dst, R12, registerOffset(operand));
+            }
+            else if (operand.kind == Kind::Constant) {
+                m_assembler.mov(dst, m_program.constants[operand.index].getValue().getBits());
+            }
+            else {
+                m_assembler.load(RDX, RSP, slotOffset(operand));
+                m_assembler.load(dst, RDX, 0);
+            }
+        }
+
+        void loadNumber(const app::RegisterOperand& operand, const Register dst, const Label fail)
+        {
+            loadBits(operand, dst);
+            if (operand.kind != Kind::Constant) {
+                m_assembler.cmp(dst, R14);
+                m_assembler.jump(Above, fail);
+            }
+        }
+
+        // Writes the number or bool in rax like RegisterEvaluator::write
+        void storeValue(const app::RegisterOperand& operand, const Label fail)
+        {
+            auto& as = m_assembler;
+
+            if (operand.kind == Kind::Register) {
+                const auto offset = registerOffset(operand);
+                as.load(RDX, R12, offset);
+                as.cmp(RDX, R15);
+                as.jump(AboveEqual, fail);
+                as.store(R12, offset, RAX);
+                as.store32(R12, offset + CATEGORY_OFFSET, static_cast<int32_t>(app::Symbol::ValueCategory::Rvalue));
+            }
+            else if (isSlot(operand)) {
+                as.load(RDX, RSP, slotOffset(operand));
+                as.load(RSI, RDX, 0);
+                as.cmp(RSI, RBP);
+                as.jump(AboveEqual, fail);
+                as.cmp32(RDX, CATEGORY_OFFSET, static_cast<int8_t>(app::Symbol::ValueCategory::Lvalue));
+                as.jump(NotEqual, fail);
+                as.store(RDX, 0, RAX);
+            }
+        }
+
+        void emitNumberOperation(const size_t position, const app::RegisterInstruction& instruction)
+        {
+            auto& as = m_assembler;
+            const auto op = instruction.op;
+            const auto fail = as.createLabel();
+            const auto done = as.createLabel();
+
+            for (const auto* operand : { &instruction.a, &instruction.b, &instruction.c }) {
+                if (isSlot(*operand)) {
+                    resolveSlot(*operand, fail);
+                }
+            }
+
+            loadNumber(instruction.b, RAX, fail);
+
+            if (op != app::OpCode::DEREF && op != app::OpCode::ASSIGN) {
+                loadNumber(instruction.c, RCX, fail);
+                as.movq(XMM0, RAX);
+                as.movq(XMM1, RCX);
+
+                if (isBinaryMathOp(op)) {
+                    emitMath(op);
+                }
+                else {
+                    emitCompare(op);
+                }
+            }
+
+            storeValue(instruction.a, fail);
+
+            if (isComparisonOp(op) && isBranchOn(position + 1, instruction.a)) {
+                emitFusedBranch(m_program.instructions[position + 1]);
+            }
+            as.jmp(done);
+
+            // Other types and operands are handled by the interpreter
+            as.bind(fail);
+            emitStep(position);
+            as.cmp(RAX, static_cast<int32_t>(position + 1));
+            as.jump(NotEqual, m_epilogue);
+
+            as.bind(done);
+        }
+
+        bool isBranchOn(const size_t position, const app::RegisterOperand& operand) const
+        {
+            if (position >= m_end || operand.kind != Kind::Register) {
+                return false;
+            }
+
+            const auto& instruction = m_program.instructions[position];
+            return instruction.op == app::OpCode::IF &&
+                instruction.a.kind == Kind::Register && instruction.a.index == operand.index;
+        }
+
+        // Runs the following IF on the comparison result in rax
+        void emitFusedBranch(const app::RegisterInstruction& branch)
+        {
+            auto& as = m_assembler;
+
+            as.increment(R13, 0);
+            as.mov(RCX, app::Value::getBoolBits(true));
+            as.cmp(RAX, RCX);
+            as.jump(Equal, labelOf(branch.b.index));
+            as.jmp(labelOf(branch.c.index));
+        }
+
+        void emitMath(const app::OpCode op)
+        {
+            auto& as = m_assembler;
+
+            switch (op) {
+            case app::OpCode::ADD:
+                as.sse(ADDSD, XMM0, XMM1);
+                break;
+            case app::OpCode::SUB:
+                as.sse(SUBSD, XMM0, XMM1);
+                break;
+            case app::OpCode::MUL:
+                as.sse(MULSD, XMM0, XMM1);
+                break;
+            default:
+                as.sse(DIVSD, XMM0, XMM1);
+                break;
+            }
+
+            // NaNs must not look like boxed values
+            const auto number = as.createLabel();
+            as.movq(RAX, XMM0);
+            as.ucomisd(XMM0, XMM0);
+            as.jump(NoParity, number);
+            as.mov(RAX, app::Value::getCanonicalNanBits());
+            as.bind(number);
+        }
+
+        void emitCompare(const app::OpCode op)
+        {
+            auto& as = m_assembler;
+
+            // Unordered comparisons set carry, zero and parity flags
+            switch (op) {
+            case app::OpCode::EQ:
+                as.ucomisd(XMM0, XMM1);
+                as.set(Equal, RAX);
+                as.set(NoParity, RCX);
+                as.and32(RAX, RCX);
+                break;
+            case app::OpCode::NEQ:
+                as.ucomisd(XMM0, XMM1);
+                as.set(NotEqual, RAX);
+                as.set(Parity, RCX);
+                as.or32(RAX, RCX);
+                break;
+            case app::OpCode::LT:
+                as.ucomisd(XMM1, XMM0);
+                as.set(Above, RAX);
+                break;
+            case app::OpCode::LE:
+                as.ucomisd(XMM1, XMM0);
+                as.set(AboveEqual, RAX);
+                break;
+            case app::OpCode::GT:
+                as.ucomisd(XMM0, XMM1);
+                as.set(Above, RAX);
+                break;
+            default:
+                as.ucomisd(XMM0, XMM1);
+                as.set(AboveEqual, RAX);
+                break;
+            }
+
+            as.movzx8(RAX, RAX);
+            as.mov(RCX, app::Value::getBoolBits(false));
+            as.or64(RAX, RCX);
+        }
+
+        void emitIf(const size_t position, const app::RegisterInstruction& instruction)
+        {
+            auto& as = m_assembler;
+            const auto slow = as.createLabel();
+            const auto onTrue = labelOf(instruction.b.index);
+            const auto onFalse = labelOf(instruction.c.index);
+
+            if (instruction.a.kind == Kind::Register || isSlot(instruction.a)) {
+                if (isSlot(instruction.a)) {
+                    resolveSlot(instruction.a, slow);
+                }
+
+                loadBits(instruction.a, RAX);
+                as.mov(RCX, app::Value::getBoolBits(true));
+                as.cmp(RAX, RCX);
+                as.jump(Equal, onTrue);
+                as.mov(RCX, app::Value::getBoolBits(false));
+                as.cmp(RAX, RCX);
+                as.jump(Equal, onFalse);
+            }
+
+            as.bind(slow);
+            callRuntime(reinterpret_cast<const void*>(m_runtime.condition), position);
+            as.cmp(RAX, 1);
+            as.jump(Equal, onTrue);
+            as.test(RAX, RAX);
+            as.jump(Equal, onFalse);
+            as.jmp(m_epilogue);
+        }
+
+        const app::JitRuntime& m_runtime;
+        const app::RegisterProgram& m_program;
+        const size_t m_begin;
+        const size_t m_end;
+
+        Assembler m_assembler;
+        std::vector<Label> m_labels;
+        Label m_epilogue = 0;
+        std::unordered_map<size_t, Label> m_exits;     // position -> exit label
+        std::unordered_map<size_t, size_t> m_slots;    // slot key -> cache index
+        std::vector<size_t> m_entries;
+    };
+}
+
+app::JitFunction::JitFunction(void* code, const size_t size, const size_t begin, const size_t end,
+    std::vector<size_t> entries) :
+    m_code(code), m_size(size), m_begin(begin), m_end(end), m_entries(std::move(entries))
+{
+}
+
+app::JitFunction::~JitFunction()
+{
+#ifdef USL_JIT
+    munmap(m_code, m_size);
+#endif
+}
+
+size_t app::JitFunction::getBegin() const
+{
+    return m_begin;
+}
+
+size_t app::JitFunction::getEnd() const
+{
+    return m_end;
+}
+
+const std::vector<size_t>& app::JitFunction::getEntries() const
+{
+    return m_entries;
+}
+
+app::JitCompiler::JitCompiler(const JitRuntime& runtime) :
+    m_runtime(runtime)
+{
+}
+
+bool app::JitCompiler::isSupported()
+{
+#ifdef USL_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<app::JitFunction> app::JitCompiler::compile(const RegisterProgram& program,
+    const size_t begin, const size_t end) const
+{
+#ifdef USL_JIT
+    details::Translator translator{ m_runtime, program, begin, end };
+    if (!translator.translate()) {
+        return nullptr;
+    }
+
+    const auto code = translator.finish();
+
+    auto* memory = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+
+    std::memcpy(memory, code.data(), code.size());
+    if (mprotect(memory, code.size(), PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, code.size());
+        return nullptr;
+    }
+
+    return std::make_unique<JitFunction>(memory, code.size(), begin, end, translator.getEntries());
+#else
+    (void)program;
+    (void)begin;
+    (void)end;
+    return nullptr;
+#endif
+}
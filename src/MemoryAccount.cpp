@@ -0,0 +1,130 @@
+#include "MemoryAccount.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace details
+{
+    thread_local app::MemoryAccount* currentAccount = nullptr;
+}
+
+app::MemoryAccount::Scope::Scope(MemoryAccount* account) :
+    m_previous(std::exchange(details::currentAccount, account))
+{
+}
+
+app::MemoryAccount::Scope::~Scope()
+{
+    details::currentAccount = m_previous;
+}
+
+app::MemoryAccount::MemoryAccount()
+{
+    for (size_t i = 0; i < CATEGORY_COUNT; ++i) {
+        m_resources[i].account = this;
+        m_resources[i].category = static_cast<Category>(i);
+    }
+}
+
+app::MemoryAccount* app::MemoryAccount::getCurrent()
+{
+    return details::currentAccount;
+}
+
+const char* app::MemoryAccount::getName(const Category category)
+{
+    switch (category) {
+    case Category::Strings:
+        return "strings";
+    case Category::Symbols:
+        return "symbols";
+    case Category::Scopes:
+        return "scopes";
+    case Category::Objects:
+        return "objects";
+    default:
+        return "unknown";
+    }
+}
+
+std::pmr::memory_resource* app::MemoryAccount::getResource(const Category category)
+{
+    return &m_resources[static_cast<size_t>(category)];
+}
+
+void app::MemoryAccount::charge(const Category category, const size_t size)
+{
+    if (size > m_quota - m_liveSize) {
+        throw std::runtime_error{ "Memory quota exceeded. Unable to allocate " + std::to_string(size) +
+            " bytes of " + getName(category) + ", " + std::to_string(m_liveSize) + " of " +
+            std::to_string(m_quota) + " bytes are used" };
+    }
+
+    const auto index = static_cast<size_t>(category);
+    m_liveSize += size;
+    m_liveSizes[index] += size;
+    m_peakSize = std::max(m_peakSize, m_liveSize);
+    m_peakSizes[index] = std::max(m_peakSizes[index], m_liveSizes[index]);
+}
+
+void app::MemoryAccount::discharge(const Category category, const size_t size) noexcept
+{
+    m_liveSize -= size;
+    m_liveSizes[static_cast<size_t>(category)] -= size;
+}
+
+void app::MemoryAccount::setQuota(const size_t quota)
+{
+    m_quota = quota;
+}
+
+size_t app::MemoryAccount::getQuota() const
+{
+    return m_quota;
+}
+
+size_t app::MemoryAccount::getLiveSize() const
+{
+    return m_liveSize;
+}
+
+size_t app::MemoryAccount::getPeakSize() const
+{
+    return m_peakSize;
+}
+
+size_t app::MemoryAccount::getLiveSize(const Category category) const
+{
+    return m_liveSizes[static_cast<size_t>(category)];
+}
+
+size_t app::MemoryAccount::getPeakSize(const Category category) const
+{
+    return m_peakSizes[static_cast<size_t>(category)];
+}
+
+void* app::MemoryAccount::Resource::do_allocate(const size_t size, const size_t alignment)
+{
+    account->charge(category, size);
+
+    try {
+        return std::pmr::get_default_resource()->allocate(size, alignment);
+    }
+    catch (...) {
+        account->discharge(category, size);
+        throw;
+    }
+}
+
+void app::MemoryAccount::Resource::do_deallocate(void* memory, const size_t size, const size_t alignment)
+{
+    std::pmr::get_default_resource()->deallocate(memory, size, alignment);
+    account->discharge(category, size);
+}
+
+bool app::MemoryAccount::Resource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
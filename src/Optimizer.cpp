@@ -0,0 +1,378 @@
+#include "Optimizer.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Symbol.hpp"
+#include "ByteCodeAnalysis.hpp"
+#include "VariableResolver.hpp"
+
+using namespace app::bytecode_analysis;
+
+namespace details
+{
+    bool isLiteral(const app::ByteCodeItem& item)
+    {
+        return std::visit([](auto && arg) {
+            using T = std::decay_t<decltype(arg)>;
+            return is_any_of_v<T, std::nullopt_t, bool, double, std::string>;
+        }, item);
+    }
+
+    app::Symbol toSymbol(const app::ByteCodeItem& item)
+    {
+        app::Symbol result{ app::Symbol::ValueCategory::Rvalue };
+        std::visit([&result](auto && arg) {
+            using T = std::decay_t<decltype(arg)>;
+
+            if constexpr (is_any_of_v<T, std::nullopt_t, bool, double, std::string>) {
+                result = app::Symbol{ arg, app::Symbol::ValueCategory::Rvalue };
+            }
+        }, item);
+        return result;
+    }
+
+
+    bool isSameVariable(const app::ByteCodeItem& left, const app::ByteCodeItem& right)
+    {
+        using namespace app;
+
+        if (left.index() != right.index()) {
+            return false;
+        }
+        if (const auto* name = std::get_if<std::string_view>(&left)) {
+            return *name == std::get<std::string_view>(right);
+        }
+        if (const auto* slot = std::get_if<LocalSlot>(&left)) {
+            return slot->index == std::get<LocalSlot>(right).index;
+        }
+        if (const auto* slot = std::get_if<GlobalSlot>(&left)) {
+            return slot->index == std::get<GlobalSlot>(right).index;
+        }
+        return false;
+    }
+
+    std::optional<app::ByteCodeItem> toLiteral(const app::Symbol& symbol)
+    {
+        std::optional<app::ByteCodeItem> result;
+        symbol.visit([&result](auto && arg) {
+            using T = std::decay_t<decltype(arg)>;
+
+            if constexpr (is_any_of_v<T, std::nullopt_t, bool, double, std::string>) {
+                result = arg;
+            }
+        });
+        return result;
+    }
+
+    // Evaluates operation exactly as Evaluator would do it at runtime.
+    // Returns nothing if operation fails, so the error is reported at runtime
+    std::optional<app::ByteCodeItem> evaluate(const app::OpCode op,
+        const app::ByteCodeItem& left, const app::ByteCodeItem* right)
+    {
+        using namespace app;
+
+        try {
+            const auto symbolLeft = toSymbol(left);
+
+            if (isUnaryMathOp(op)) {
+                return toLiteral(symbolLeft.operationUnary(op));
+            }
+
+            const auto symbolRight = toSymbol(*right);
+
+            if (isBinaryMathOp(op)) {
+                return toLiteral(symbolLeft.operationBinaryMath(symbolRight, op));
+            }
+            if (isLogicOp(op)) {
+                return toLiteral(symbolLeft.operationLogic(symbolRight, op));
+            }
+            if (isComparisonOp(op)) {
+                return toLiteral(symbolLeft.operationCompare(symbolRight, op));
+            }
+        }
+        catch (const std::runtime_error&) {
+        }
+
+        return std::nullopt;
+    }
+}
+
+std::vector<app::ByteCodeItem> app::Optimizer::optimize(const std::vector<ByteCodeItem>& byteCode)
+{
+    m_byteCode = byteCode;
+
+    // Propagated constants can produce new foldable expressions and vice versa
+    while (true) {
+        auto changed = foldConstants();
+        changed = propagateConstants() || changed;
+
+        if (!changed) {
+            break;
+        }
+    }
+
+    // Constant propagation works with names, so variables are resolved last
+    VariableResolver{}.resolve(m_byteCode);
+
+    fuseInstructions();
+    eliminateTailCalls();
+
+    return m_byteCode;
+}
+
+bool app::Optimizer::foldConstants()
+{
+    const auto isTarget = findJumpTargets(m_byteCode);
+
+    std::vector<ByteCodeItem> result;
+    result.reserve(m_byteCode.size());
+
+    std::vector<bool> resultIsTarget;
+    resultIsTarget.reserve(m_byteCode.size());
+
+    std::vector<size_t> positions(m_byteCode.size() + 1, 0);
+
+    auto changed = false;
+    for (size_t i = 0; i < m_byteCode.size(); ++i) {
+        positions[i] = result.size();
+
+        const auto& item = m_byteCode[i];
+
+        const auto* op = std::get_if<OpCode>(&item);
+        if (op != nullptr && !isTarget[i]) {
+            const auto size = result.size();
+
+            if (isUnaryMathOp(*op) && size >= 1 && details::isLiteral(result[size - 1])) {
+                const auto folded = details::evaluate(*op, result[size - 1], nullptr);
+                if (folded.has_value()) {
+                    result.back() = *folded;
+                    changed = true;
+                    continue;
+                }
+            }
+
+            if ((isBinaryMathOp(*op) || isLogicOp(*op) || isComparisonOp(*op)) && size >= 2 &&
+                details::isLiteral(result[size - 2]) &&
+                details::isLiteral(result[size - 1]) && !resultIsTarget[size - 1])
+            {
+                const auto folded = details::evaluate(*op, result[size - 2], &result[size - 1]);
+                if (folded.has_value()) {
+                    result.pop_back();
+                    resultIsTarget.pop_back();
+                    result.back() = *folded;
+                    changed = true;
+                    continue;
+                }
+            }
+        }
+
+        result.emplace_back(item);
+        resultIsTarget.push_back(isTarget[i]);
+    }
+    positions[m_byteCode.size()] = result.size();
+
+    if (!changed) {
+        return false;
+    }
+
+    for (auto& item : result) {
+        auto* pointer = std::get_if<Pointer>(&item);
+        if (pointer != nullptr) {
+            *pointer = positions[*pointer];
+        }
+    }
+
+    m_byteCode = std::move(result);
+    return true;
+}
+
+bool app::Optimizer::propagateConstants()
+{
+    const auto operands = analyzeOperands(m_byteCode);
+    const auto blockDepth = analyzeBlockDepth(m_byteCode);
+
+    const auto consumerOf = [this, &operands](const size_t i) -> std::optional<OpCode> {
+        const auto consumer = operands[i].consumer;
+        if (consumer == NO_INDEX) {
+            return std::nullopt;
+        }
+        return std::get<OpCode>(m_byteCode[consumer]);
+    };
+
+    // Collect all variables which can't be treated as constants
+    std::unordered_map<std::string_view, size_t> declarations;
+    std::unordered_map<std::string_view, size_t> assignments;
+    std::unordered_set<std::string_view> mutated;
+
+    for (size_t i = 0; i < m_byteCode.size(); ++i) {
+        const auto* name = std::get_if<std::string_view>(&m_byteCode[i]);
+        const auto consumer = consumerOf(i);
+        if (name == nullptr || !consumer.has_value()) {
+            continue;
+        }
+
+        switch (*consumer) {
+        case OpCode::DECLVAR:
+        case OpCode::DECLFUN:
+        case OpCode::DECLARG:
+        case OpCode::DECLARGREF:
+            ++declarations[*name];
+            break;
+
+        case OpCode::ASSIGN:
+            if (operands[i].slot == 1) {
+                ++assignments[*name];
+            }
+            break;
+
+        case OpCode::ASSIGNREF:
+        case OpCode::PUSHARG:
+        case OpCode::CALL:
+            mutated.emplace(*name);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    auto changed = false;
+    for (size_t i = 1; i + 3 < m_byteCode.size(); ++i) {
+        // Looking for global 'let' with literal initializer:
+        // var, DECLVAR, var, literal, ASSIGN
+        const auto* op = std::get_if<OpCode>(&m_byteCode[i]);
+        if (op == nullptr || *op != OpCode::DECLVAR || blockDepth[i] != 0) {
+            continue;
+        }
+
+        const auto* name = std::get_if<std::string_view>(&m_byteCode[i - 1]);
+        const auto* target = std::get_if<std::string_view>(&m_byteCode[i + 1]);
+        const auto* assign = std::get_if<OpCode>(&m_byteCode[i + 3]);
+
+        if (name == nullptr || target == nullptr || *name != *target ||
+            !details::isLiteral(m_byteCode[i + 2]) ||
+            assign == nullptr || *assign != OpCode::ASSIGN ||
+            operands[i + 1].consumer != i + 3 || operands[i + 2].consumer != i + 3)
+        {
+            continue;
+        }
+
+        if (declarations[*name] != 1 || assignments[*name] != 1 || mutated.find(*name) != mutated.end()) {
+            continue;
+        }
+
+        const auto value = m_byteCode[i + 2];
+        const auto variable = *name;
+
+        for (auto j = i + 4; j < m_byteCode.size(); ++j) {
+            const auto* use = std::get_if<std::string_view>(&m_byteCode[j]);
+            const auto consumer = consumerOf(j);
+            if (use == nullptr || *use != variable || !consumer.has_value()) {
+                continue;
+            }
+
+            const auto isRead =
+                *consumer == OpCode::DEREF ||
+                *consumer == OpCode::POP ||
+                *consumer == OpCode::IF ||
+                isUnaryMathOp(*consumer) ||
+                isBinaryMathOp(*consumer) ||
+                isLogicOp(*consumer) ||
+                isComparisonOp(*consumer) ||
+                (*consumer == OpCode::ASSIGN && operands[j].slot == 0);
+
+            if (isRead) {
+                m_byteCode[j] = value;
+                changed = true;
+            }
+        }
+    }
+
+    return changed;
+}
+
+void app::Optimizer::fuseInstructions()
+{
+    const auto isTarget = findJumpTargets(m_byteCode);
+    const auto operands = analyzeOperands(m_byteCode);
+
+    const auto hasTargets = [&isTarget](const size_t begin, const size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            if (isTarget[i]) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    const auto isConsumedBy = [&operands](const size_t item, const size_t consumer, const size_t slot) {
+        return operands[item].consumer == consumer && operands[item].slot == slot;
+    };
+
+    std::vector<bool> removed(m_byteCode.size(), false);
+
+    for (size_t i = 0; i < m_byteCode.size(); ++i) {
+        const auto& item = m_byteCode[i];
+
+        // var, var, number, ADD, ASSIGN -> var, number, INCVAR
+        if (i + 4 < m_byteCode.size() &&
+            details::isSameVariable(item, m_byteCode[i + 1]) &&
+            std::holds_alternative<double>(m_byteCode[i + 2]) &&
+            isOp(m_byteCode[i + 3], OpCode::ADD) &&
+            isOp(m_byteCode[i + 4], OpCode::ASSIGN) &&
+            !hasTargets(i + 1, i + 5) &&
+            isConsumedBy(i, i + 4, 1) && isConsumedBy(i + 3, i + 4, 0))
+        {
+            removed[i + 1] = true;
+            removed[i + 3] = true;
+            m_byteCode[i + 4] = OpCode::INCVAR;
+            i += 4;
+            continue;
+        }
+
+        // LT, ptr, ptr, IF -> ptr, ptr, LT_JMP
+        if (i + 3 < m_byteCode.size() &&
+            isOp(item, OpCode::LT) &&
+            std::holds_alternative<Pointer>(m_byteCode[i + 1]) &&
+            std::holds_alternative<Pointer>(m_byteCode[i + 2]) &&
+            isOp(m_byteCode[i + 3], OpCode::IF) &&
+            !hasTargets(i + 1, i + 4) &&
+            isConsumedBy(i, i + 3, 0))
+        {
+            removed[i] = true;
+            m_byteCode[i + 3] = OpCode::LT_JMP;
+            i += 3;
+            continue;
+        }
+
+        // STRUCTREF, CALL -> CALL_MEMBER
+        if (i + 1 < m_byteCode.size() &&
+            isOp(item, OpCode::STRUCTREF) &&
+            isOp(m_byteCode[i + 1], OpCode::CALL) &&
+            !isTarget[i + 1] &&
+            isConsumedBy(i, i + 1, 0))
+        {
+            removed[i] = true;
+            m_byteCode[i + 1] = OpCode::CALL_MEMBER;
+            i += 1;
+            continue;
+        }
+    }
+
+    removeItems(m_byteCode, removed);
+}
+
+void app::Optimizer::eliminateTailCalls()
+{
+    // 'return f(...);' is translated to: f, CALL, DEREF, DELBLOCK..., RET.
+    // Frame can be reused only if there are no named scope blocks to delete
+    for (size_t i = 0; i + 2 < m_byteCode.size(); ++i) {
+        if (isOp(m_byteCode[i], OpCode::CALL) &&
+            isOp(m_byteCode[i + 1], OpCode::DEREF) &&
+            isOp(m_byteCode[i + 2], OpCode::RET))
+        {
+            m_byteCode[i] = OpCode::TAILCALL;
+        }
+    }
+}
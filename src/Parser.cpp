@@ -5,6 +5,35 @@
 #include <functional>
 
 #include "ByteCode.hpp"
+#include "ByteCodeAnalysis.hpp"
+
+using namespace app::bytecode_analysis;
+
+namespace details
+{
+    // 'return' leaves its value on the stack: value, DELBLOCK..., RET
+    bool isReturnValue(const std::vector<app::ByteCodeItem>& byteCode, size_t position)
+    {
+        while (++position < byteCode.size() && isOp(byteCode[position], app::OpCode::DELBLOCK)) {
+        }
+        return position < byteCode.size() && isOp(byteCode[position], app::OpCode::RET);
+    }
+
+    // Results of expression statements are never used, pop them to keep the stack balanced
+    void discardUnusedValues(std::vector<app::ByteCodeItem>& byteCode)
+    {
+        const auto operands = analyzeOperands(byteCode);
+
+        std::vector<std::pair<size_t, app::ByteCodeItem>> pops;
+        for (size_t i = 0; i < byteCode.size(); ++i) {
+            if (pushesValue(byteCode[i]) && operands[i].consumer == NO_INDEX && !isReturnValue(byteCode, i)) {
+                pops.emplace_back(i + 1, app::OpCode::POP);
+            }
+        }
+
+        insertItems(byteCode, std::move(pops));
+    }
+}
 
 app::Parser::Parser(const bool loggingEnabled) :
     m_loggingEnabled(loggingEnabled), m_grammar(ParserGrammar::create())
@@ -145,7 +174,10 @@ std::vector<app::ByteCodeItem> app::Parser::parse(const std::vector<Token>& toke
     CommandBuffer commandBuffer;
     RuleSet::defaultTranslator(commandBuffer, root);
 
-    return commandBuffer.generate();
+    auto byteCode = commandBuffer.generate();
+    details::discardUnusedValues(byteCode);
+
+    return byteCode;
 }
 
 void app::Parser::scan(const size_t i, const size_t j, const Token& token)
@@ -179,13 +211,16 @@ void app::Parser::predict(const size_t i, const size_t j, const ParserGrammar& g
 
 void app::Parser::complete(const size_t i, const size_t j)
 {
-    const auto& currentItem = m_stateSets[i][j];
+    // state sets can grow while completing, so don't hold references into them
+    const auto name = m_stateSets[i][j].getName();
+    const auto origin = m_stateSets[i][j].getOrigin();
 
-    for (const auto& item : m_stateSets[currentItem.getOrigin()]) {
-        const auto* nextSymbol = item.getNextNonTerm();
+    for (size_t k = 0; k < m_stateSets[origin].size(); ++k) {
+        const auto* nextSymbol = m_stateSets[origin][k].getNextNonTerm();
 
-        if (nextSymbol && nextSymbol->name == currentItem.getName()) {
-            tryEmplace(m_stateSets[i], item.createAdvanced(1));
+        if (nextSymbol && nextSymbol->name == name) {
+            const auto advanced = m_stateSets[origin][k].createAdvanced(1);
+            tryEmplace(m_stateSets[i], advanced);
         }
     }
 }
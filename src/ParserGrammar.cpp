@@ -86,6 +86,7 @@ app::ParserGrammar::ParserGrammar()
         .set().nonterm(Expression).term(Semicolon).hide()
         .set().term(KeywordReturn).term(Semicolon)
             .translate([](CommandBuffer & cb, SyntaxNode & node) {
+                cb.push(std::nullopt);
                 cb.translate([](CommandBuffer & cb) {
                     cb.clearBlocks();
                 });
@@ -141,6 +142,8 @@ app::ParserGrammar::ParserGrammar()
 
                 cb.translate(*node.children[3]);
 
+                // Calls always yield a value
+                cb.push(std::nullopt);
                 cb.push(OpCode::DELBLOCK);
                 cb.push(OpCode::RET);
                 cb.replyPosition(endPosition);
@@ -169,10 +172,7 @@ app::ParserGrammar::ParserGrammar()
         return [offset, isReference](CommandBuffer& cb, SyntaxNode& node) {
             const auto token = std::get<const Token*>(node.children[offset]->value);
             cb.push(convert(*token));
-            cb.push(OpCode::DECLVAR);
-            cb.push(convert(*token));
-            cb.push(OpCode::POPARG);
-            cb.push(isReference ? OpCode::ASSIGNREF : OpCode::ASSIGN);
+            cb.push(isReference ? OpCode::DECLARGREF : OpCode::DECLARG);
         };
     };
 
@@ -511,7 +511,11 @@ app::ParserGrammar::ParserGrammar()
             })
         .set().nonterm(PostfixExpression).nonterm(CallArguments)
             .translate([](CommandBuffer & cb, SyntaxNode & node) {
+                // Arguments: '(', expression, [',', expression]..., ')'
+                const auto argumentCount = (node.children[1]->children.size() - 1) / 2;
+
                 cb.translate(*node.children[1]);
+                cb.push(static_cast<double>(argumentCount));
                 cb.translate(*node.children[0]);
                 cb.push(OpCode::CALL);
             })
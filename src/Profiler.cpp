@@ -0,0 +1,75 @@
+#include "Profiler.hpp"
+
+#include <vector>
+#include <algorithm>
+
+namespace details
+{
+    // Items are encoded by their kind, opcodes are encoded after the kinds
+    constexpr uint8_t OPCODE_OFFSET = std::variant_size_v<app::ByteCodeItem>;
+
+    uint8_t encode(const app::ByteCodeItem& item)
+    {
+        const auto* op = std::get_if<app::OpCode>(&item);
+        if (op != nullptr) {
+            return static_cast<uint8_t>(OPCODE_OFFSET + static_cast<uint8_t>(*op));
+        }
+        return static_cast<uint8_t>(item.index());
+    }
+
+    std::string decode(const uint8_t code)
+    {
+        if (code >= OPCODE_OFFSET) {
+            return app::toString(static_cast<app::OpCode>(code - OPCODE_OFFSET));
+        }
+
+        static const char* names[] = { "null", "bool", "number", "string", "var", "op", "ptr", "local", "global" };
+        static_assert(std::size(names) == OPCODE_OFFSET);
+
+        return names[code];
+    }
+}
+
+void app::Profiler::record(const ByteCodeItem& item)
+{
+    std::move(m_history.begin() + 1, m_history.end(), m_history.begin());
+    m_history.back() = details::encode(item);
+    m_historySize = std::min(m_historySize + 1, MAX_SEQUENCE_LENGTH);
+
+    ++m_itemCount;
+
+    Key key = 0;
+    for (size_t length = 1; length <= m_historySize; ++length) {
+        key |= static_cast<Key>(m_history[MAX_SEQUENCE_LENGTH - length]) << (8 * (length - 1));
+
+        if (length >= MIN_SEQUENCE_LENGTH) {
+            ++m_sequences[length][key];
+        }
+    }
+}
+
+void app::Profiler::print(const size_t count) const
+{
+    printf("Executed items: %zu\n", m_itemCount);
+
+    for (auto length = MIN_SEQUENCE_LENGTH; length <= MAX_SEQUENCE_LENGTH; ++length) {
+        std::vector<std::pair<Key, size_t>> sequences(m_sequences[length].begin(), m_sequences[length].end());
+
+        const auto size = std::min(count, sequences.size());
+        std::partial_sort(sequences.begin(), sequences.begin() + size, sequences.end(),
+            [](const auto& left, const auto& right) { return left.second > right.second; });
+
+        printf("Most frequent sequences of %zu items:\n", length);
+        for (size_t i = 0; i < size; ++i) {
+            const auto&[key, frequency] = sequences[i];
+
+            printf("%10zu %5.1f%% ", frequency, 100.0 * frequency / m_itemCount);
+
+            // The oldest item is stored in the highest byte
+            for (auto j = length; j > 0; --j) {
+                printf(" %s", details::decode(static_cast<uint8_t>(key >> (8 * (j - 1)))).c_str());
+            }
+            printf("\n");
+        }
+    }
+}
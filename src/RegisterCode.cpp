@@ -0,0 +1,37 @@
+#include "RegisterCode.hpp"
+
+void app::print(const RegisterProgram& program, const RegisterInstruction& instruction)
+{
+    const auto printOperand = [&program](const RegisterOperand& operand) {
+        switch (operand.kind) {
+        case RegisterOperand::Kind::Register:
+            printf(" r%zu", operand.index);
+            break;
+        case RegisterOperand::Kind::Constant:
+            printf(" ");
+            program.constants[operand.index].print();
+            break;
+        case RegisterOperand::Kind::Variable:
+            printf(" var: %s", std::string{ program.names[operand.index] }.c_str());
+            break;
+        case RegisterOperand::Kind::Local:
+            printf(" local: %zu", operand.index);
+            break;
+        case RegisterOperand::Kind::Global:
+            printf(" global: %zu", operand.index);
+            break;
+        case RegisterOperand::Kind::Address:
+            printf(" ptr: %zu", operand.index);
+            break;
+        case RegisterOperand::Kind::None:
+        default:
+            printf(" _");
+            break;
+        }
+    };
+
+    printf("op: %s", toString(instruction.op).c_str());
+    printOperand(instruction.a);
+    printOperand(instruction.b);
+    printOperand(instruction.c);
+}
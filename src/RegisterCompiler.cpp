@@ -0,0 +1,366 @@
+#include "RegisterCompiler.hpp"
+
+#include "ByteCodeAnalysis.hpp"
+
+using namespace app::bytecode_analysis;
+
+namespace details
+{
+    constexpr bool producesValue(const app::OpCode op)
+    {
+        using app::OpCode;
+
+        return
+            op == OpCode::DEREF ||
+            op == OpCode::STRUCTREF ||
+            op == OpCode::CALL ||
+            op == OpCode::TAILCALL ||
+            isUnaryMathOp(op) ||
+            isBinaryMathOp(op) ||
+            isLogicOp(op) ||
+            isComparisonOp(op);
+    }
+
+    constexpr bool isVariable(const app::RegisterOperand& operand)
+    {
+        using Kind = app::RegisterOperand::Kind;
+
+        return operand.kind == Kind::Variable || operand.kind == Kind::Local || operand.kind == Kind::Global;
+    }
+}
+
+app::RegisterProgram app::RegisterCompiler::compile(const std::vector<ByteCodeItem>& byteCode)
+{
+    m_byteCode = &byteCode;
+    m_program = RegisterProgram{};
+    m_nameIndices.clear();
+    m_stack.clear();
+    m_pointerStack.clear();
+
+    const auto targets = findJumpTargets(byteCode);
+    const auto operands = analyzeOperands(byteCode);
+
+    std::vector<size_t> positions(byteCode.size() + 1, 0);
+
+    for (size_t i = 0; i < byteCode.size(); ++i) {
+        positions[i] = m_program.instructions.size();
+
+        // Stack is always empty between statements
+        if (targets[i]) {
+            m_stack.clear();
+            m_pointerStack.clear();
+        }
+
+        const auto isUsed = operands[i].consumer != NO_INDEX || isReturnValue(i);
+
+        const auto result = [this, isUsed]() {
+            return isUsed ? pushRegister() : RegisterOperand{};
+        };
+
+        std::visit([this, i, isUsed, &byteCode, &result](auto && arg) {
+            using T = std::decay_t<decltype(arg)>;
+
+            if constexpr (std::is_same_v<T, Pointer>) {
+                m_pointerStack.push_back(arg);
+            }
+            else if constexpr (std::is_same_v<T, std::string_view>) {
+                if (isUsed) {
+                    push(createVariable(arg));
+                }
+            }
+            else if constexpr (std::is_same_v<T, LocalSlot>) {
+                if (isUsed) {
+                    push(RegisterOperand{ RegisterOperand::Kind::Local, arg.index, addName(getName(arg)) });
+                }
+            }
+            else if constexpr (std::is_same_v<T, GlobalSlot>) {
+                if (isUsed) {
+                    push(RegisterOperand{ RegisterOperand::Kind::Global, arg.index, addName(getName(arg)) });
+                }
+            }
+            else if constexpr (!std::is_same_v<T, OpCode>) {
+                if (isUsed) {
+                    push(createConstant(byteCode[i]));
+                }
+            }
+            else {
+                switch (arg) {
+                case OpCode::DECLVAR:
+                case OpCode::DECLARG:
+                case OpCode::DECLARGREF:
+                {
+                    const auto a = pop();
+                    emit(arg, a);
+                    break;
+                }
+
+                case OpCode::DECLFUN:
+                {
+                    const auto a = pop();
+                    emit(arg, a, RegisterOperand{ RegisterOperand::Kind::Address, popPointer() });
+                    break;
+                }
+
+                case OpCode::ASSIGN:
+                {
+                    const auto b = pop();
+                    const auto a = pop();
+
+                    // Write result of the previous instruction directly to the variable
+                    auto& instructions = m_program.instructions;
+                    if (details::isVariable(a) &&
+                        b.kind == RegisterOperand::Kind::Register &&
+                        !instructions.empty() &&
+                        details::producesValue(instructions.back().op) &&
+                        instructions.back().a.kind == RegisterOperand::Kind::Register &&
+                        instructions.back().a.index == b.index)
+                    {
+                        instructions.back().a = a;
+                        break;
+                    }
+
+                    emit(arg, a, b);
+                    break;
+                }
+
+                case OpCode::ASSIGNREF:
+                {
+                    const auto b = pop();
+                    const auto a = pop();
+                    emit(arg, a, b);
+                    break;
+                }
+
+                case OpCode::DEREF:
+                case OpCode::NOT:
+                case OpCode::UNM:
+                {
+                    const auto b = pop();
+                    emit(arg, result(), b);
+                    break;
+                }
+
+                case OpCode::CALL:
+                case OpCode::TAILCALL:
+                {
+                    const auto b = pop();
+                    const auto c = pop();
+                    emit(arg, result(), b, c);
+                    break;
+                }
+
+                case OpCode::POP:
+                    pop();
+                    break;
+
+                case OpCode::IF:
+                {
+                    const auto a = pop();
+                    const auto falsePointer = popPointer();
+                    const auto truePointer = popPointer();
+                    emit(arg, a,
+                        RegisterOperand{ RegisterOperand::Kind::Address, truePointer },
+                        RegisterOperand{ RegisterOperand::Kind::Address, falsePointer });
+                    break;
+                }
+
+                case OpCode::JMP:
+                    emit(arg, RegisterOperand{ RegisterOperand::Kind::Address, popPointer() });
+                    break;
+
+                case OpCode::RET:
+                {
+                    auto a = RegisterOperand{};
+
+                    auto previous = i;
+                    while (previous > 0 && std::get_if<OpCode>(&byteCode[previous - 1]) != nullptr &&
+                        std::get<OpCode>(byteCode[previous - 1]) == OpCode::DELBLOCK)
+                    {
+                        --previous;
+                    }
+                    if (previous > 0 && isReturnValue(previous - 1)) {
+                        a = pop();
+                    }
+
+                    emit(arg, a);
+                    break;
+                }
+
+                case OpCode::PUSHARG:
+                {
+                    const auto a = pop();
+                    emit(arg, a);
+                    break;
+                }
+
+                case OpCode::DEFBLOCK:
+                case OpCode::DELBLOCK:
+                    emit(arg, RegisterOperand{});
+                    break;
+
+                // Superinstructions of the stack code are already three-address
+                case OpCode::INCVAR:
+                {
+                    const auto b = pop();
+                    const auto a = pop();
+                    emit(OpCode::ADD, a, a, b);
+                    break;
+                }
+
+                case OpCode::LT_JMP:
+                {
+                    const auto c = pop();
+                    const auto b = pop();
+                    const auto condition = pushRegister();
+                    pop();
+
+                    const auto falsePointer = popPointer();
+                    const auto truePointer = popPointer();
+                    emit(OpCode::LT, condition, b, c);
+                    emit(OpCode::IF, condition,
+                        RegisterOperand{ RegisterOperand::Kind::Address, truePointer },
+                        RegisterOperand{ RegisterOperand::Kind::Address, falsePointer });
+                    break;
+                }
+
+                case OpCode::CALL_MEMBER:
+                {
+                    const auto c = pop();
+                    const auto b = pop();
+                    const auto member = pushRegister();
+                    emit(OpCode::STRUCTREF, member, b, c);
+                    pop();
+
+                    const auto count = pop();
+                    emit(OpCode::CALL, result(), member, count);
+                    break;
+                }
+
+                default:
+                {
+                    const auto c = pop();
+                    const auto b = pop();
+                    emit(arg, result(), b, c);
+                    break;
+                }
+                }
+            }
+        }, byteCode[i]);
+    }
+    positions[byteCode.size()] = m_program.instructions.size();
+
+    // Resolve bytecode positions to instruction indices
+    for (auto& instruction : m_program.instructions) {
+        for (auto* operand : { &instruction.a, &instruction.b, &instruction.c }) {
+            if (operand->kind == RegisterOperand::Kind::Address) {
+                operand->index = positions[operand->index];
+            }
+        }
+    }
+
+    m_byteCode = nullptr;
+
+    return std::move(m_program);
+}
+
+app::RegisterOperand app::RegisterCompiler::pop()
+{
+    if (m_stack.empty()) {
+        return RegisterOperand{};
+    }
+
+    const auto result = m_stack.back();
+    m_stack.pop_back();
+    return result;
+}
+
+app::Pointer app::RegisterCompiler::popPointer()
+{
+    if (m_pointerStack.empty()) {
+        throw std::runtime_error{ "Unable to compile register code. Pointer stack is empty" };
+    }
+
+    const auto result = m_pointerStack.back();
+    m_pointerStack.pop_back();
+    return result;
+}
+
+void app::RegisterCompiler::push(const RegisterOperand& operand)
+{
+    m_stack.push_back(operand);
+}
+
+app::RegisterOperand app::RegisterCompiler::pushRegister()
+{
+    const auto result = RegisterOperand{ RegisterOperand::Kind::Register, m_stack.size() };
+    m_stack.push_back(result);
+
+    m_program.registerCount = std::max(m_program.registerCount, m_stack.size());
+    return result;
+}
+
+app::RegisterOperand app::RegisterCompiler::createConstant(const ByteCodeItem& item)
+{
+    std::visit([this](auto && arg) {
+        using T = std::decay_t<decltype(arg)>;
+
+        if constexpr (std::is_same_v<T, std::string>) {
+            m_program.constants.emplace_back(Value::intern(arg), Symbol::ValueCategory::Rvalue);
+        }
+        else if constexpr (details::is_any_of_v<T, std::nullopt_t, bool, double>) {
+            m_program.constants.emplace_back(arg, Symbol::ValueCategory::Rvalue);
+        }
+        else {
+            throw std::runtime_error{ "Unable to compile register code. Invalid constant" };
+        }
+    }, item);
+
+    return RegisterOperand{ RegisterOperand::Kind::Constant, m_program.constants.size() - 1 };
+}
+
+app::RegisterOperand app::RegisterCompiler::createVariable(const std::string_view name)
+{
+    return RegisterOperand{ RegisterOperand::Kind::Variable, addName(name) };
+}
+
+size_t app::RegisterCompiler::addName(const std::string_view name)
+{
+    const auto[it, inserted] = m_nameIndices.try_emplace(name, m_program.names.size());
+    if (inserted) {
+        m_program.names.push_back(name);
+    }
+
+    return it->second;
+}
+
+void app::RegisterCompiler::emit(const OpCode op, const RegisterOperand& a,
+    const RegisterOperand& b, const RegisterOperand& c)
+{
+    m_program.instructions.push_back(RegisterInstruction{ op, a, b, c });
+}
+
+bool app::RegisterCompiler::isReturnValue(const size_t position) const
+{
+    // 'return expression;' is translated to: expression, DEREF, DELBLOCK..., RET
+    const auto& byteCode = *m_byteCode;
+
+    const auto* op = std::get_if<OpCode>(&byteCode[position]);
+    if (op == nullptr || *op != OpCode::DEREF) {
+        return false;
+    }
+
+    for (auto i = position + 1; i < byteCode.size(); ++i) {
+        const auto* next = std::get_if<OpCode>(&byteCode[i]);
+        if (next == nullptr) {
+            return false;
+        }
+        if (*next == OpCode::RET) {
+            return true;
+        }
+        if (*next != OpCode::DELBLOCK) {
+            return false;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,642 @@
+#include "RegisterEvaluator.hpp"
+
+#include "CoreObject.hpp"
+#include "CoreFunction.hpp"
+
+app::RegisterEvaluator::RegisterEvaluator(Evaluator& evaluator, const bool loggingEnabled, const bool jitEnabled) :
+    m_evaluator(evaluator), m_loggingEnabled(loggingEnabled)
+{
+    // Native code doesn't log its instructions
+    if (jitEnabled && !loggingEnabled && JitCompiler::isSupported()) {
+        m_jitCompiler = std::make_unique<JitCompiler>(JitRuntime{
+            this, &m_instructionCount, &jitStep, &jitCondition, &jitRegisters, &jitVariable });
+    }
+}
+
+void app::RegisterEvaluator::eval(const RegisterProgram& program)
+{
+    m_program = &program;
+    m_position = 0;
+    m_base = 0;
+    m_registers.assign(program.registerCount, Symbol{ Symbol::ValueCategory::Rvalue });
+    m_frames.clear();
+    m_memberCaches.assign(program.instructions.size(), MemberCache{});
+
+    const auto& instructions = program.instructions;
+
+    m_jitFunctions.clear();
+    m_nativeCode.assign(instructions.size(), nullptr);
+    m_functionEnds.assign(instructions.size(), 0);
+    m_callCounts.assign(instructions.size(), 0);
+    m_loopCounts.assign(instructions.size(), 0);
+
+    // function declaration: DECLFUN name, address; JMP end
+    for (size_t i = 0; i + 1 < instructions.size(); ++i) {
+        const auto& instruction = instructions[i];
+        const auto& next = instructions[i + 1];
+
+        if (instruction.op == OpCode::DECLFUN && instruction.b.index < instructions.size() &&
+            next.op == OpCode::JMP && next.a.index <= instructions.size())
+        {
+            m_functionEnds[instruction.b.index] = next.a.index;
+        }
+    }
+
+    // Registers are owned by the host side, values created while running are charged to the evaluator
+    const MemoryAccount::Scope scope{ &m_evaluator.getMemory() };
+
+    while (m_position < instructions.size()) {
+        if (const auto* function = m_nativeCode[m_position]; function != nullptr) {
+            const auto position = function->run(m_position);
+
+            if (position == JitFunction::ERROR) {
+                std::rethrow_exception(std::exchange(m_jitError, nullptr));
+            }
+            if (position != JitFunction::NOT_ENTERED) {
+                m_position = position;
+                continue;
+            }
+        }
+
+        const auto& instruction = instructions[m_position];
+
+        if (m_loggingEnabled) {
+            printf("[%3zu] base: %zu | ", m_position, m_base);
+            print(program, instruction);
+            printf("\n");
+        }
+
+        ++m_instructionCount;
+
+        execute(instruction);
+    }
+
+    m_program = nullptr;
+}
+
+size_t app::RegisterEvaluator::getInstructionCount() const
+{
+    return m_instructionCount;
+}
+
+void app::RegisterEvaluator::execute(const RegisterInstruction& instruction)
+{
+    switch (instruction.op) {
+    case OpCode::DECLVAR:
+    case OpCode::DECLFUN:
+        handleDecl(instruction);
+        break;
+
+    case OpCode::ASSIGN:
+    case OpCode::ASSIGNREF:
+        handleAssign(instruction);
+        break;
+
+    case OpCode::DEREF:
+        handleDeref(instruction);
+        break;
+
+    case OpCode::STRUCTREF:
+        handleStructRef(instruction);
+        break;
+
+    case OpCode::NOT:
+    case OpCode::UNM:
+        handleUnaryOperator(instruction);
+        break;
+
+    case OpCode::ADD:
+    case OpCode::SUB:
+    case OpCode::MUL:
+    case OpCode::DIV:
+    case OpCode::AND:
+    case OpCode::OR:
+    case OpCode::EQ:
+    case OpCode::NEQ:
+    case OpCode::LT:
+    case OpCode::LE:
+    case OpCode::GT:
+    case OpCode::GE:
+        handleBinaryOperator(instruction);
+        break;
+
+    case OpCode::IF:
+    case OpCode::JMP:
+    case OpCode::CALL:
+    case OpCode::TAILCALL:
+    case OpCode::RET:
+        handleControl(instruction);
+        break;
+
+    case OpCode::PUSHARG:
+    case OpCode::DECLARG:
+    case OpCode::DECLARGREF:
+        handleArguments(instruction);
+        break;
+
+    case OpCode::DEFBLOCK:
+        m_evaluator.pushBlock();
+        ++m_position;
+        break;
+
+    case OpCode::DELBLOCK:
+        m_evaluator.popBlock();
+        ++m_position;
+        break;
+
+    default:
+        throw std::runtime_error("Unknown opcode");
+    }
+}
+
+void app::RegisterEvaluator::printTiers() const
+{
+    const auto size = m_functionEnds.size();
+
+    // Loops compiled on their own, grouped by the innermost function
+    std::vector<size_t> functionOf(size, size);
+    for (size_t address = 0; address < size; ++address) {
+        if (m_functionEnds[address] > address) {
+            std::fill(functionOf.begin() + address, functionOf.begin() + m_functionEnds[address], address);
+        }
+    }
+
+    std::vector<size_t> loops(size + 1, 0);
+    std::vector<bool> native(size + 1, false);
+    for (const auto& function : m_jitFunctions) {
+        const auto owner = functionOf[function->getBegin()];
+        if (owner == function->getBegin()) {
+            native[owner] = true;
+        }
+        else {
+            ++loops[owner];
+        }
+    }
+
+    const auto printTier = [&loops, &native](const size_t owner) {
+        printf("%s", native[owner] ? "native" : "interpreter");
+        if (loops[owner] != 0) {
+            printf(", loops compiled on stack: %zu", loops[owner]);
+        }
+        printf("\n");
+    };
+
+    printf("Tiers:\n");
+    printf("\ttop level: ");
+    printTier(size);
+
+    for (size_t address = 0; address < size; ++address) {
+        if (m_functionEnds[address] > address) {
+            printf("\tfunction at %zu: %zu calls, ", address, m_callCounts[address]);
+            printTier(address);
+        }
+    }
+}
+
+void app::RegisterEvaluator::countCall(const size_t address)
+{
+    if (++m_callCounts[address] == JIT_THRESHOLD && m_jitCompiler != nullptr && m_functionEnds[address] > address) {
+        compile(address, m_functionEnds[address]);
+    }
+}
+
+void app::RegisterEvaluator::countBackEdge(const size_t header, const size_t end)
+{
+    if (++m_loopCounts[header] == OSR_THRESHOLD && m_jitCompiler != nullptr) {
+        compile(header, end);
+    }
+}
+
+void app::RegisterEvaluator::compile(const size_t begin, const size_t end)
+{
+    auto function = m_jitCompiler->compile(*m_program, begin, end);
+    if (function == nullptr) {
+        return;
+    }
+
+    // Code compiled later takes over the shared entries, both are valid
+    for (const auto entry : function->getEntries()) {
+        m_nativeCode[entry] = function.get();
+    }
+    m_jitFunctions.push_back(std::move(function));
+}
+
+void app::RegisterEvaluator::handleDecl(const RegisterInstruction& instruction)
+{
+    const auto& a = instruction.a;
+
+    if (instruction.op == OpCode::DECLVAR) {
+        switch (a.kind) {
+        case RegisterOperand::Kind::Variable:
+            m_evaluator.declareVariable(m_program->names[a.index]);
+            break;
+        case RegisterOperand::Kind::Local:
+            m_evaluator.declareVariable(toLocal(a));
+            break;
+        case RegisterOperand::Kind::Global:
+            m_evaluator.declareVariable(toGlobal(a));
+            break;
+        default:
+            throw std::runtime_error{ "Unable to read DECLVAR arguments. Invalid argument type" };
+        }
+    }
+    else if (instruction.op == OpCode::DECLFUN) {
+        switch (a.kind) {
+        case RegisterOperand::Kind::Variable:
+            m_evaluator.declareFunction(m_program->names[a.index], instruction.b.index);
+            break;
+        case RegisterOperand::Kind::Global:
+            m_evaluator.declareFunction(toGlobal(a), instruction.b.index);
+            break;
+        default:
+            throw std::runtime_error{ "Unable to read DECLFUN arguments. Invalid argument type" };
+        }
+    }
+
+    ++m_position;
+}
+
+void app::RegisterEvaluator::handleAssign(const RegisterInstruction& instruction)
+{
+    if (instruction.op == OpCode::ASSIGN) {
+        access(instruction.a).assign(read(instruction.b));
+    }
+    else if (instruction.op == OpCode::ASSIGNREF) {
+        if (read(instruction.b).getValueCategory() != Symbol::ValueCategory::Lvalue) {
+            throw std::runtime_error{ "Unable to get reference of rvalue" };
+        }
+
+        auto& value = access(instruction.b);
+        access(instruction.a) = Symbol{ &value };
+    }
+
+    ++m_position;
+}
+
+void app::RegisterEvaluator::handleDeref(const RegisterInstruction& instruction)
+{
+    write(instruction.a, Symbol{ read(instruction.b).unref(), Symbol::ValueCategory::Rvalue });
+
+    ++m_position;
+}
+
+void app::RegisterEvaluator::handleStructRef(const RegisterInstruction& instruction)
+{
+    if (instruction.c.kind != RegisterOperand::Kind::Variable) {
+        throw std::runtime_error{ "Unable to read STRUCTREF member name argument" };
+    }
+
+    const auto& memberName = m_program->names[instruction.c.index];
+
+    // keep the object alive while its member is written to the result
+    const auto object = read(instruction.b).unref();
+
+    object.visit([this, &instruction, &memberName](auto && arg) {
+        using T = std::decay_t<decltype(arg)>;
+
+        if constexpr (std::is_same_v<T, CoreObjectPtr>) {
+            if (arg == nullptr) {
+                throw std::runtime_error{ "CoreObject is null" };
+            }
+
+            // Instruction pairs of CALL_MEMBER call the method right away
+            const auto& instructions = m_program->instructions;
+            const auto isCalled = m_position + 1 < instructions.size() &&
+                instructions[m_position + 1].op == OpCode::CALL &&
+                instructions[m_position + 1].b.kind == instruction.a.kind &&
+                instructions[m_position + 1].b.index == instruction.a.index;
+
+            write(instruction.a, m_evaluator.getMember(arg, memberName, m_memberCaches[m_position], isCalled));
+        }
+        else {
+            throw std::runtime_error{ "Unable to access member of non core object" };
+        }
+    });
+
+    ++m_position;
+}
+
+void app::RegisterEvaluator::handleUnaryOperator(const RegisterInstruction& instruction)
+{
+    write(instruction.a, read(instruction.b).unref().operationUnary(instruction.op));
+
+    ++m_position;
+}
+
+void app::RegisterEvaluator::handleBinaryOperator(const RegisterInstruction& instruction)
+{
+    const auto op = instruction.op;
+
+    const auto& symbolLeft = read(instruction.b).unref();
+    const auto& symbolRight = read(instruction.c).unref();
+
+    if (isBinaryMathOp(op)) {
+        write(instruction.a, symbolLeft.operationBinaryMath(symbolRight, op));
+    }
+    else if (isLogicOp(op)) {
+        write(instruction.a, symbolLeft.operationLogic(symbolRight, op));
+    }
+    else if (isComparisonOp(op)) {
+        write(instruction.a, symbolLeft.operationCompare(symbolRight, op));
+    }
+
+    ++m_position;
+}
+
+void app::RegisterEvaluator::handleControl(const RegisterInstruction& instruction)
+{
+    const auto opIf = [this, &instruction]() {
+        m_position = readCondition(instruction.a) ? instruction.b.index : instruction.c.index;
+    };
+
+    const auto opCall = [this, &instruction]() {
+        const auto callee = read(instruction.b).unref();
+        const auto argumentCount = static_cast<size_t>(read(instruction.c).getValue().asNumber());
+
+        callee.visit([this, &instruction, argumentCount](auto && arg) {
+            using T = std::decay_t<decltype(arg)>;
+
+            if constexpr (std::is_same_v<T, ScriptFunction>) {
+                m_frames.push_back(Frame{ m_position + 1, m_base, instruction.a });
+                m_evaluator.pushFrame(argumentCount);
+
+                // Callee registers start after all registers of the caller
+                m_base += m_program->registerCount;
+                if (m_registers.size() < m_base + m_program->registerCount) {
+                    m_registers.resize(m_base + m_program->registerCount, Symbol{ Symbol::ValueCategory::Rvalue });
+                }
+
+                m_position = arg.address;
+
+                countCall(arg.address);
+            }
+            else if constexpr (std::is_same_v<T, CoreFunctionPtr>) {
+                const auto stackSize = m_evaluator.getStackSize();
+
+                m_evaluator.beginFunctionArguments(argumentCount);
+                arg->call(m_evaluator);
+                m_evaluator.clearFunctionArguments();
+
+                Symbol result{ Symbol::ValueCategory::Rvalue };
+                if (m_evaluator.getStackSize() > stackSize) {
+                    result = m_evaluator.pop();
+                }
+                write(instruction.a, std::move(result));
+
+                ++m_position;
+            }
+            else {
+                throw std::runtime_error("Wrong CALL argument type");
+            }
+        });
+    };
+
+    const auto opRet = [this, &instruction]() {
+        if (m_frames.empty()) {
+            throw std::runtime_error{ "Unable to read RET arguments. Call stack is empty" };
+        }
+
+        Symbol result{ Symbol::ValueCategory::Rvalue };
+        if (instruction.a.kind != RegisterOperand::Kind::None) {
+            result = read(instruction.a);
+        }
+
+        m_evaluator.popFrame();
+
+        const auto frame = m_frames.back();
+        m_frames.pop_back();
+
+        m_base = frame.base;
+        write(frame.result, std::move(result));
+
+        m_position = frame.returnPosition;
+    };
+
+    switch (instruction.op) {
+    case OpCode::IF:
+        opIf();
+        return;
+    case OpCode::JMP:
+        // Backward jumps close loops, which are compiled when hot
+        if (instruction.a.index <= m_position) {
+            countBackEdge(instruction.a.index, m_position + 1);
+        }
+        m_position = instruction.a.index;
+        return;
+    case OpCode::CALL:
+        opCall();
+        return;
+    case OpCode::TAILCALL:
+        if (!tailCall(instruction)) {
+            opCall();
+        }
+        return;
+    case OpCode::RET:
+        opRet();
+        return;
+    default:
+        return;
+    }
+}
+
+bool app::RegisterEvaluator::tailCall(const RegisterInstruction& instruction)
+{
+    std::optional<Pointer> address;
+    read(instruction.b).unref().visit([&address](auto && arg) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(arg)>, ScriptFunction>) {
+            address = arg.address;
+        }
+    });
+
+    // Parameters are declared by the first instructions of the callee
+    const auto& instructions = m_program->instructions;
+    const auto isValueParameter = [&instructions, &address](const size_t index) {
+        const auto position = *address + index;
+        return position < instructions.size() && instructions[position].op == OpCode::DECLARG;
+    };
+
+    const auto argumentCount = static_cast<size_t>(read(instruction.c).getValue().asNumber());
+    if (!address.has_value() || m_frames.empty() || !m_evaluator.reuseFrame(argumentCount, isValueParameter)) {
+        return false;
+    }
+
+    // The callee takes over the registers of the frame and returns straight to our caller
+    m_position = *address;
+    countCall(*address);
+
+    return true;
+}
+
+void app::RegisterEvaluator::handleArguments(const RegisterInstruction& instruction)
+{
+    if (instruction.op == OpCode::PUSHARG) {
+        const auto kind = instruction.a.kind;
+        if (kind == RegisterOperand::Kind::Variable ||
+            kind == RegisterOperand::Kind::Local ||
+            kind == RegisterOperand::Kind::Global)
+        {
+            m_evaluator.pushFunctionArgument(Symbol{ &access(instruction.a) });
+        }
+        else {
+            m_evaluator.pushFunctionArgument(read(instruction.a));
+        }
+    }
+    else {
+        const auto isReference = instruction.op == OpCode::DECLARGREF;
+
+        switch (instruction.a.kind) {
+        case RegisterOperand::Kind::Variable:
+            m_evaluator.declareArgument(m_program->names[instruction.a.index], isReference);
+            break;
+        case RegisterOperand::Kind::Local:
+            m_evaluator.declareArgument(toLocal(instruction.a), isReference);
+            break;
+        case RegisterOperand::Kind::Global:
+            m_evaluator.declareArgument(toGlobal(instruction.a), isReference);
+            break;
+        default:
+            throw std::runtime_error{ "Unable to read " + toString(instruction.op) + " arguments. Invalid argument type" };
+        }
+    }
+
+    ++m_position;
+}
+
+const app::Symbol& app::RegisterEvaluator::read(const RegisterOperand& operand)
+{
+    switch (operand.kind) {
+    case RegisterOperand::Kind::Register:
+        return m_registers[m_base + operand.index];
+    case RegisterOperand::Kind::Constant:
+        return m_program->constants[operand.index];
+    case RegisterOperand::Kind::Variable:
+        return m_evaluator.findVariable(m_program->names[operand.index]);
+    case RegisterOperand::Kind::Local:
+        return m_evaluator.findVariable(toLocal(operand));
+    case RegisterOperand::Kind::Global:
+        return m_evaluator.findVariable(toGlobal(operand));
+    default:
+        throw std::runtime_error{ "Unable to read instruction operand" };
+    }
+}
+
+app::Symbol& app::RegisterEvaluator::access(const RegisterOperand& operand)
+{
+    switch (operand.kind) {
+    case RegisterOperand::Kind::Register:
+        return m_registers[m_base + operand.index];
+    case RegisterOperand::Kind::Variable:
+        return m_evaluator.findVariable(m_program->names[operand.index]);
+    case RegisterOperand::Kind::Local:
+        return m_evaluator.findVariable(toLocal(operand));
+    case RegisterOperand::Kind::Global:
+        return m_evaluator.findVariable(toGlobal(operand));
+    case RegisterOperand::Kind::Constant:
+        throw std::runtime_error{ "Unable to assign value to rvalue" };
+    default:
+        throw std::runtime_error{ "Unable to read instruction operand" };
+    }
+}
+
+void app::RegisterEvaluator::write(const RegisterOperand& operand, Symbol value)
+{
+    switch (operand.kind) {
+    case RegisterOperand::Kind::None:
+        return;
+    case RegisterOperand::Kind::Register:
+        m_registers[m_base + operand.index] = std::move(value);
+        return;
+    case RegisterOperand::Kind::Variable:
+        m_evaluator.findVariable(m_program->names[operand.index]).assign(std::move(value));
+        return;
+    case RegisterOperand::Kind::Local:
+        m_evaluator.findVariable(toLocal(operand)).assign(std::move(value));
+        return;
+    case RegisterOperand::Kind::Global:
+        m_evaluator.findVariable(toGlobal(operand)).assign(std::move(value));
+        return;
+    default:
+        throw std::runtime_error{ "Unable to write instruction result" };
+    }
+}
+
+app::LocalSlot app::RegisterEvaluator::toLocal(const RegisterOperand& operand) const
+{
+    return makeSlot<LocalSlot>(operand.index, m_program->names[operand.name]);
+}
+
+app::GlobalSlot app::RegisterEvaluator::toGlobal(const RegisterOperand& operand) const
+{
+    return makeSlot<GlobalSlot>(operand.index, m_program->names[operand.name]);
+}
+
+bool app::RegisterEvaluator::readCondition(const RegisterOperand& operand)
+{
+    auto value = false;
+    read(operand).unref().visit([&value](auto && arg) {
+        using T = std::decay_t<decltype(arg)>;
+
+        if constexpr (std::is_same_v<T, std::nullopt_t>) {
+            value = false;
+            return;
+        }
+        else if constexpr (details::is_any_of_v<T, bool, double>) {
+            value = static_cast<bool>(arg);
+            return;
+        }
+
+        throw std::runtime_error{ "Unable to read IF arguments. Invalid argument type" };
+    });
+
+    return value;
+}
+
+size_t app::RegisterEvaluator::jitStep(void* context, const size_t position)
+{
+    auto& self = *static_cast<RegisterEvaluator*>(context);
+
+    // Exceptions can't unwind native code
+    try {
+        self.m_position = position;
+        self.execute(self.m_program->instructions[position]);
+        return self.m_position;
+    }
+    catch (...) {
+        self.m_jitError = std::current_exception();
+        return JitFunction::ERROR;
+    }
+}
+
+size_t app::RegisterEvaluator::jitCondition(void* context, const size_t position)
+{
+    auto& self = *static_cast<RegisterEvaluator*>(context);
+
+    try {
+        return self.readCondition(self.m_program->instructions[position].a) ? 1 : 0;
+    }
+    catch (...) {
+        self.m_jitError = std::current_exception();
+        return JitFunction::ERROR;
+    }
+}
+
+app::Symbol* app::RegisterEvaluator::jitRegisters(void* context)
+{
+    auto& self = *static_cast<RegisterEvaluator*>(context);
+    return self.m_registers.data() + self.m_base;
+}
+
+app::Symbol* app::RegisterEvaluator::jitVariable(void* context, const size_t kind, const size_t index)
+{
+    auto& self = *static_cast<RegisterEvaluator*>(context);
+
+    try {
+        if (static_cast<RegisterOperand::Kind>(kind) == RegisterOperand::Kind::Local) {
+            return &self.m_evaluator.findVariable(makeSlot<LocalSlot>(index, {}));
+        }
+        return &self.m_evaluator.findVariable(makeSlot<GlobalSlot>(index, {}));
+    }
+    catch (const std::runtime_error&) {
+        return nullptr;
+    }
+}
@@ -0,0 +1,90 @@
+#include "ScriptHost.hpp"
+
+#include <limits>
+#include <sstream>
+
+#include "Lexer.hpp"
+#include "Optimizer.hpp"
+#include "Parser.hpp"
+#include "StandardLibrary.hpp"
+#include "Verifier.hpp"
+
+app::ScriptHost::ScriptHost(const size_t threadCount) :
+    m_pool(threadCount)
+{
+}
+
+std::unique_ptr<const app::Program> app::ScriptHost::compile(std::string name, std::string text, const bool optimize)
+{
+    auto program = std::make_unique<Program>();
+    program->name = std::move(name);
+    program->text = std::move(text);
+
+    const auto tokens = Lexer{}.run(program->text);
+    program->byteCode = Parser{ false }.parse(tokens);
+
+    if (optimize) {
+        program->byteCode = Optimizer{}.optimize(program->byteCode);
+    }
+    program->verified = Verifier{}.verify(program->byteCode);
+
+    return program;
+}
+
+void app::ScriptHost::submit(const Program& program, Result& result)
+{
+    m_pool.submit([this, &program, &result]() {
+        result = run(program);
+    });
+}
+
+void app::ScriptHost::wait()
+{
+    m_pool.wait();
+}
+
+app::ScriptHost::Result app::ScriptHost::run(const Program& program) const
+{
+    Result result;
+
+    std::istringstream input;
+    std::ostringstream output;
+
+    // Streams outlive the evaluator, which holds the library
+    Evaluator evaluator{ false };
+    evaluator.setStackLimit(m_stackLimit);
+    evaluator.getMemory().setQuota(m_memoryQuota);
+
+    try {
+        auto standardLibrary = makeRef<StandardLibrary>(input, output);
+        evaluator.registerVariable("std", standardLibrary);
+
+        evaluator.load(program.byteCode, program.verified);
+        result.status = evaluator.run(std::numeric_limits<size_t>::max());
+        result.error = evaluator.getError();
+    }
+    catch (const std::exception& e) {
+        result.status = Evaluator::Status::Error;
+        result.error = e.what();
+    }
+
+    result.output = output.str();
+    result.instructionCount = evaluator.getInstructionCount();
+    result.peakMemory = evaluator.getMemory().getPeakSize();
+    return result;
+}
+
+void app::ScriptHost::setStackLimit(const size_t limit)
+{
+    m_stackLimit = limit;
+}
+
+void app::ScriptHost::setMemoryQuota(const size_t quota)
+{
+    m_memoryQuota = quota;
+}
+
+const app::ThreadPool& app::ScriptHost::getPool() const
+{
+    return m_pool;
+}
@@ -1,7 +1,8 @@
 #include "StandardLibrary.hpp"
 
-#include "CoreFunction.hpp"
+#include "CoreClass.hpp"
 
+#include <cmath>
 #include <iostream>
 
 namespace app::standard_functions
@@ -44,16 +45,25 @@ namespace app::standard_objects
     class LinkedListNode final : public CoreObject
     {
     public:
-        LinkedListNode()
+        LinkedListNode() :
+            CoreObject(getClass())
         {
-            registerMember("new", std::make_shared<SimpleCoreFunction>([](Evaluator& evaluator) {
-                evaluator.push(Symbol{ std::make_shared<LinkedListNode>(), Symbol::ValueCategory::Rvalue });
-            }));
+        }
 
-            registerMember("value", std::nullopt);
+    protected:
+        void collectSymbols(std::vector<Symbol*>& symbols) override
+        {
+            CoreObject::collectSymbols(symbols);
+            symbols.push_back(&m_next);
+            symbols.push_back(&m_prev);
+        }
 
-            const auto createSetter = [](Symbol& symbol) {
-                return [&symbol](Evaluator & evaluator) {
+    private:
+        static const CoreClass& getClass()
+        {
+            const auto createSetter = [](Symbol LinkedListNode::* member) {
+                return [member](Evaluator & evaluator, CoreObject & object) {
+                    auto& symbol = static_cast<LinkedListNode&>(object).*member;
                     const auto node = evaluator.popFunctionArgument().unref();
 
                     if (node.getType() == Symbol::Type::Null) {
@@ -69,20 +79,25 @@ namespace app::standard_objects
                 };
             };
 
-            registerMember("set_next", std::make_shared<SimpleCoreFunction>(createSetter(m_next)));
-
-            registerMember("get_next", std::make_shared<SimpleCoreFunction>([this](Evaluator & evaluator) {
-                evaluator.push(Symbol{ m_next, Symbol::ValueCategory::Rvalue });
-            }));
-
-            registerMember("set_prev", std::make_shared<SimpleCoreFunction>(createSetter(m_prev)));
+            const auto createGetter = [](Symbol LinkedListNode::* member) {
+                return [member](Evaluator & evaluator, CoreObject & object) {
+                    evaluator.push(Symbol{ static_cast<LinkedListNode&>(object).*member, Symbol::ValueCategory::Rvalue });
+                };
+            };
 
-            registerMember("get_prev", std::make_shared<SimpleCoreFunction>([this](Evaluator & evaluator) {
-                evaluator.push(Symbol{ m_prev, Symbol::ValueCategory::Rvalue });
-            }));
+            static const CoreClass result{ { "value" }, {
+                { "new", [](Evaluator & evaluator, CoreObject&) {
+                    evaluator.push(Symbol{ makeRef<LinkedListNode>(), Symbol::ValueCategory::Rvalue });
+                } },
+                { "set_next", createSetter(&LinkedListNode::m_next) },
+                { "get_next", createGetter(&LinkedListNode::m_next) },
+                { "set_prev", createSetter(&LinkedListNode::m_prev) },
+                { "get_prev", createGetter(&LinkedListNode::m_prev) },
+            } };
+
+            return result;
         }
 
-    private:
         Symbol m_next{ Symbol::ValueCategory::Lvalue };
         Symbol m_prev{ Symbol::ValueCategory::Lvalue };
     };
@@ -93,7 +108,7 @@ namespace app::standard_objects
         Math()
         {
             const auto createUnaryMathOperation = [](auto && op) {
-                return [&op](Evaluator & evaluator) {
+                return [op](Evaluator & evaluator) {
                     const auto arg = evaluator.popFunctionArgument().unref();
 
                     auto result = 0.0;
@@ -113,7 +128,7 @@ namespace app::standard_objects
             };
 
             const auto createBinaryMathOperation = [](auto&& op) {
-                return [&op](Evaluator & evaluator) {
+                return [op](Evaluator & evaluator) {
                     const auto argLeft = evaluator.popFunctionArgument().unref();
                     const auto argRight = evaluator.popFunctionArgument().unref();
 
@@ -155,7 +170,7 @@ namespace app::standard_objects
             };
 
             for (const auto&[name, function] : unaryFunctions) {
-                registerMember(name, std::make_shared<SimpleCoreFunction>(createUnaryMathOperation(function)));
+                registerMember(name, makeRef<SimpleCoreFunction>(createUnaryMathOperation(function)));
             }
 
             const std::unordered_map<std::string, double(*)(double, double)> binaryFunctions = {
@@ -165,7 +180,7 @@ namespace app::standard_objects
             };
 
             for (const auto& [name, function] : binaryFunctions) {
-                registerMember(name, std::make_shared<SimpleCoreFunction>(createBinaryMathOperation(function)));
+                registerMember(name, makeRef<SimpleCoreFunction>(createBinaryMathOperation(function)));
             }
         }
     };
@@ -173,67 +188,84 @@ namespace app::standard_objects
     class Pair final : public CoreObject
     {
     public:
-        Pair()
+        Pair() :
+            CoreObject(getClass())
+        {
+        }
+
+    private:
+        static const CoreClass& getClass()
         {
-            registerMember("new", std::make_shared<SimpleCoreFunction>([](Evaluator & evaluator) {
-                evaluator.push(Symbol{ std::make_shared<Pair>(), Symbol::ValueCategory::Rvalue });
-            }));
+            static const CoreClass result{ { "first", "second" }, {
+                { "new", [](Evaluator & evaluator, CoreObject&) {
+                    evaluator.push(Symbol{ makeRef<Pair>(), Symbol::ValueCategory::Rvalue });
+                } },
+            } };
 
-            registerMember("first", std::nullopt);
-            registerMember("second", std::nullopt);
+            return result;
         }
     };
 
     class Tuple final : public CoreObject
     {
     public:
-        Tuple()
+        Tuple() :
+            CoreObject(getClass())
         {
-            registerMember("new", std::make_shared<SimpleCoreFunction>([](Evaluator & evaluator) {
-                auto result = std::make_shared<Tuple>();
+        }
 
-                while (evaluator.hasFunctionArguments()) {
-                    evaluator.popFunctionArgument().unref().visit([&result](auto && arg) {
-                        using T = std::decay_t<decltype(arg)>;
+    private:
+        static const CoreClass& getClass()
+        {
+            static const CoreClass result{ {}, {
+                { "new", [](Evaluator & evaluator, CoreObject&) {
+                    auto result = makeRef<Tuple>();
 
-                        if constexpr (std::is_same_v<T, std::string>) {
-                            result->registerMember(arg, std::nullopt);
-                        }
-                        else {
-                            throw std::runtime_error{ "Wrong argument type" };
-                        }
-                    });
-                }
+                    while (evaluator.hasFunctionArguments()) {
+                        evaluator.popFunctionArgument().unref().visit([&result](auto && arg) {
+                            using T = std::decay_t<decltype(arg)>;
+
+                            if constexpr (std::is_same_v<T, std::string>) {
+                                result->registerMember(arg, std::nullopt);
+                            }
+                            else {
+                                throw std::runtime_error{ "Wrong argument type" };
+                            }
+                        });
+                    }
+
+                    evaluator.push(Symbol{ result, Symbol::ValueCategory::Rvalue });
+                } },
+            } };
 
-                evaluator.push(Symbol{ result, Symbol::ValueCategory::Rvalue });
-            }));
+            return result;
         }
     };
 }
 
-app::StandardLibrary::StandardLibrary()
+app::StandardLibrary::StandardLibrary(std::istream& input, std::ostream& output)
 {
-    registerMember("print", std::make_shared<SimpleCoreFunction>([](Evaluator& evaluator) {
-        evaluator.popFunctionArgument().unref().print();
+    registerMember("print", makeRef<SimpleCoreFunction>([&output](Evaluator& evaluator) {
+        evaluator.popFunctionArgument().unref().print(output);
     }));
 
-    registerMember("println", std::make_shared<SimpleCoreFunction>([](Evaluator & evaluator) {
-        evaluator.popFunctionArgument().unref().print();
-        printf("\n");
+    registerMember("println", makeRef<SimpleCoreFunction>([&output](Evaluator & evaluator) {
+        evaluator.popFunctionArgument().unref().print(output);
+        output << '\n';
     }));
 
-    registerMember("readln", std::make_shared<SimpleCoreFunction>([](Evaluator & evaluator) {
-        std::string input;
-        std::getline(std::cin, input);
+    registerMember("readln", makeRef<SimpleCoreFunction>([&input](Evaluator & evaluator) {
+        std::string line;
+        std::getline(input, line);
 
-        evaluator.push(Symbol{ input, Symbol::ValueCategory::Rvalue });
+        evaluator.push(Symbol{ line, Symbol::ValueCategory::Rvalue });
     }));
 
-    registerMember("hash", std::make_shared<standard_functions::HashingFunction>());
+    registerMember("hash", makeRef<standard_functions::HashingFunction>());
 
-    registerMember("Math", std::make_shared<standard_objects::Math>());
+    registerMember("Math", makeRef<standard_objects::Math>());
 
-    registerMember("LinkedListNode", std::make_shared<standard_objects::LinkedListNode>());
-    registerMember("Pair", std::make_shared<standard_objects::Pair>());
-    registerMember("Tuple", std::make_shared<standard_objects::Tuple>());
+    registerMember("LinkedListNode", makeRef<standard_objects::LinkedListNode>());
+    registerMember("Pair", makeRef<standard_objects::Pair>());
+    registerMember("Tuple", makeRef<standard_objects::Tuple>());
 }
@@ -2,6 +2,7 @@
 
 #include <stack>
 #include <cassert>
+#include <ostream>
 #include <stdexcept>
 
 namespace details
@@ -46,63 +47,83 @@ namespace details
 }
 
 app::Symbol::Symbol(const ValueCategory category) :
-    m_type(Type::Null), m_data(std::nullopt), m_valueCategory(category)
+    m_valueCategory(category)
 {
 }
 
 app::Symbol::Symbol(std::nullopt_t, const ValueCategory category) :
-    m_type(Type::Null), m_data(std::nullopt), m_valueCategory(category)
+    m_valueCategory(category)
 {
 }
 
 app::Symbol::Symbol(const bool value, const ValueCategory category) :
-    m_type(Type::Bool), m_data(value), m_valueCategory(category)
+    m_value(value), m_valueCategory(category)
 {
 }
 
 app::Symbol::Symbol(const double value, const ValueCategory category) :
-    m_type(Type::Number), m_data(value), m_valueCategory(category)
+    m_value(value), m_valueCategory(category)
 {
 }
 
 app::Symbol::Symbol(const std::string& value, const ValueCategory category) :
-    m_type(Type::String), m_data(value), m_valueCategory(category)
+    m_value(value), m_valueCategory(category)
+{
+}
+
+app::Symbol::Symbol(std::string&& value, const ValueCategory category) :
+    m_value(std::move(value)), m_valueCategory(category)
 {
 }
 
 app::Symbol::Symbol(const ScriptFunction& value, const ValueCategory category) :
-    m_type(Type::ScriptFunction), m_data(value), m_valueCategory(category)
+    m_value(value), m_valueCategory(category)
 {
 }
 
 app::Symbol::Symbol(const CoreObjectPtr& value, const ValueCategory category) :
-    m_type(Type::CoreObject), m_data(value), m_valueCategory(category)
+    m_value(value), m_valueCategory(category)
 {
 }
 
 app::Symbol::Symbol(const CoreFunctionPtr& value, const ValueCategory category) :
-    m_type(Type::CoreFunction), m_data(value), m_valueCategory(category)
+    m_value(value), m_valueCategory(category)
+{
+}
+
+app::Symbol::Symbol(Value value, const ValueCategory category) :
+    m_value(std::move(value)), m_valueCategory(category)
 {
 }
 
 app::Symbol::Symbol(const Symbol& symbol, const ValueCategory category) :
-    m_type(Type::Null), m_data(std::nullopt), m_valueCategory(category)
+    m_value(symbol.unref().m_value), m_valueCategory(category)
 {
-    const auto& unreferencedSymbol = symbol.unref();
-    m_type = unreferencedSymbol.m_type;
-    m_data = unreferencedSymbol.m_data;
+}
+
+app::Symbol::Symbol(Symbol&& symbol, const ValueCategory category) :
+    m_valueCategory(category)
+{
+    auto& unreferencedSymbol = symbol.unref();
+
+    if (&unreferencedSymbol == &symbol) {
+        m_value = std::move(symbol.m_value);
+    }
+    else {
+        m_value = unreferencedSymbol.m_value;
+    }
 }
 
 app::Symbol::Symbol(Symbol* symbol) :
-    m_type(Type::Reference), m_data(&symbol->unref()), m_valueCategory(ValueCategory::Lvalue)
+    m_value(&symbol->unref()), m_valueCategory(ValueCategory::Lvalue)
 {
 }
 
 app::Symbol& app::Symbol::unref()
 {
     auto* symbol = this;
-    while (symbol->getType() == Type::Reference) {
-        symbol = std::get<Symbol*>(m_data);
+    while (symbol->m_value.isReference()) {
+        symbol = symbol->m_value.asReference();
     }
 
     return *symbol;
@@ -111,8 +132,8 @@ app::Symbol& app::Symbol::unref()
 const app::Symbol& app::Symbol::unref() const
 {
     const auto* symbol = this;
-    while (symbol->getType() == Type::Reference) {
-        symbol = std::get<Symbol*>(m_data);
+    while (symbol->m_value.isReference()) {
+        symbol = symbol->m_value.asReference();
 
         if (symbol == this) {
             throw std::runtime_error{ "Found self linked reference" };
@@ -127,7 +148,7 @@ app::Symbol app::Symbol::operationUnary(const OpCode op) const
     assert(isUnaryMathOp(op));
 
     Symbol result{ ValueCategory::Rvalue };
-    std::visit([&result, op](auto && arg) {
+    m_value.visit([&result, op](auto && arg) {
         using T = std::decay_t<decltype(arg)>;
 
         if constexpr (std::is_same_v<T, std::nullopt_t>) {
@@ -150,7 +171,7 @@ app::Symbol app::Symbol::operationUnary(const OpCode op) const
         }
 
         throw std::runtime_error{ "Wrong " + toString(op) + " argument type" };
-    }, m_data);
+    });
 
     return result;
 }
@@ -159,14 +180,45 @@ app::Symbol app::Symbol::operationBinaryMath(const Symbol& symbol, const OpCode
 {
     assert(isBinaryMathOp(op));
 
+    if (m_value.isNumber() && symbol.m_value.isNumber()) {
+        const auto left = m_value.asNumber();
+        const auto right = symbol.m_value.asNumber();
+
+        switch (op) {
+        case OpCode::ADD:
+            return Symbol{ left + right, ValueCategory::Rvalue };
+        case OpCode::SUB:
+            return Symbol{ left - right, ValueCategory::Rvalue };
+        case OpCode::MUL:
+            return Symbol{ left * right, ValueCategory::Rvalue };
+        case OpCode::DIV:
+            return Symbol{ left / right, ValueCategory::Rvalue };
+        default:
+            return Symbol{ ValueCategory::Rvalue };
+        }
+    }
+
+    // Strings are concatenated without reading their text
+    if (op == OpCode::ADD && m_value.isString() && symbol.m_value.isString()) {
+        return Symbol{ Value::concatenate(m_value, symbol.m_value), ValueCategory::Rvalue };
+    }
+
     Symbol result{ ValueCategory::Rvalue };
-    std::visit([&result, op](auto && argLeft, auto && argRight) {
+    Value::visit([&result, op](auto && argLeft, auto && argRight) {
         using Tl = std::decay_t<decltype(argLeft)>;
         using Tr = std::decay_t<decltype(argRight)>;
 
         if constexpr (std::is_same_v<Tl, std::string> || std::is_same_v<Tr, std::string>) {
             if (op == OpCode::ADD) {
-                result = Symbol{ details::toString(argLeft) + details::toString(argRight), ValueCategory::Rvalue };
+                if constexpr (std::is_same_v<Tl, std::string> && std::is_same_v<Tr, std::string>) {
+                    std::string text;
+                    text.reserve(argLeft.size() + argRight.size());
+                    text.append(argLeft).append(argRight);
+                    result = Symbol{ std::move(text), ValueCategory::Rvalue };
+                }
+                else {
+                    result = Symbol{ details::toString(argLeft) + details::toString(argRight), ValueCategory::Rvalue };
+                }
                 return;
             }
         }
@@ -190,7 +242,7 @@ app::Symbol app::Symbol::operationBinaryMath(const Symbol& symbol, const OpCode
         }
 
         throw std::runtime_error{ "Wrong " + toString(op) + " argument types" };
-    }, m_data, symbol.m_data);
+    }, m_value, symbol.m_value);
 
     return result;
 }
@@ -200,7 +252,7 @@ app::Symbol app::Symbol::operationLogic(const Symbol& symbol, const OpCode op) c
     assert(isLogicOp(op));
 
     Symbol result{ ValueCategory::Rvalue };
-    std::visit([&result, op](auto && argLeft, auto && argRight) {
+    Value::visit([&result, op](auto && argLeft, auto && argRight) {
         using Tl = std::decay_t<decltype(argLeft)>;
         using Tr = std::decay_t<decltype(argRight)>;
 
@@ -218,7 +270,7 @@ app::Symbol app::Symbol::operationLogic(const Symbol& symbol, const OpCode op) c
         }
 
         throw std::runtime_error{ "Wrong " + toString(op) + " argument types" };
-    }, m_data, symbol.m_data);
+    }, m_value, symbol.m_value);
 
     return result;
 }
@@ -227,8 +279,34 @@ app::Symbol app::Symbol::operationCompare(const Symbol& symbol, const OpCode op)
 {
     assert(isComparisonOp(op));
 
+    if (m_value.isNumber() && symbol.m_value.isNumber()) {
+        const auto left = m_value.asNumber();
+        const auto right = symbol.m_value.asNumber();
+
+        switch (op) {
+        case OpCode::EQ:
+            return Symbol{ left == right, ValueCategory::Rvalue };
+        case OpCode::NEQ:
+            return Symbol{ left != right, ValueCategory::Rvalue };
+        case OpCode::LT:
+            return Symbol{ left < right, ValueCategory::Rvalue };
+        case OpCode::LE:
+            return Symbol{ left <= right, ValueCategory::Rvalue };
+        case OpCode::GT:
+            return Symbol{ left > right, ValueCategory::Rvalue };
+        case OpCode::GE:
+            return Symbol{ left >= right, ValueCategory::Rvalue };
+        default:
+            return Symbol{ ValueCategory::Rvalue };
+        }
+    }
+
+    if ((op == OpCode::EQ || op == OpCode::NEQ) && m_value.isString() && symbol.m_value.isString()) {
+        return Symbol{ Value::equalStrings(m_value, symbol.m_value) == (op == OpCode::EQ), ValueCategory::Rvalue };
+    }
+
     Symbol result{ ValueCategory::Rvalue };
-    std::visit([&result, op](auto && argLeft, auto && argRight) {
+    Value::visit([&result, op](auto && argLeft, auto && argRight) {
         using Tl = std::decay_t<decltype(argLeft)>;
         using Tr = std::decay_t<decltype(argRight)>;
 
@@ -272,8 +350,9 @@ app::Symbol app::Symbol::operationCompare(const Symbol& symbol, const OpCode op)
                 }
             }
 
-            using LType = std::conditional_t<details::is_any_of_v<Tl, bool, double>, double, std::string>;
-            using RType = std::conditional_t<details::is_any_of_v<Tr, bool, double>, double, std::string>;
+            // Strings are compared in place
+            using LType = std::conditional_t<details::is_any_of_v<Tl, bool, double>, double, const std::string&>;
+            using RType = std::conditional_t<details::is_any_of_v<Tr, bool, double>, double, const std::string&>;
 
             switch (op) {
             case OpCode::EQ:
@@ -300,7 +379,7 @@ app::Symbol app::Symbol::operationCompare(const Symbol& symbol, const OpCode op)
         }
 
         throw std::runtime_error{ "Wrong " + toString(op) + " argument types" };
-    }, m_data, symbol.m_data);
+    }, m_value, symbol.m_value);
 
     return result;
 }
@@ -312,9 +391,16 @@ void app::Symbol::print() const
     });
 }
 
+void app::Symbol::print(std::ostream& output) const
+{
+    visit([&output](auto && arg) {
+        output << details::toString(arg);
+    });
+}
+
 app::Symbol::Type app::Symbol::getType() const
 {
-    return m_type;
+    return m_value.getType();
 }
 
 void app::Symbol::setValueCategory(const ValueCategory category)
@@ -326,7 +412,7 @@ app::Symbol::ValueCategory app::Symbol::getValueCategory() const {
     return m_valueCategory;
 }
 
-app::Symbol::DataVariant& app::Symbol::getData()
+const app::Value& app::Symbol::getValue() const
 {
-    return m_data;
+    return m_value;
 }
@@ -0,0 +1,130 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+namespace details
+{
+    // Pool and queue of the worker running on this thread
+    thread_local const app::ThreadPool* currentPool = nullptr;
+    thread_local size_t currentQueue = 0;
+}
+
+app::ThreadPool::ThreadPool(const size_t threadCount)
+{
+    const auto count = std::max<size_t>(threadCount, 1);
+
+    for (size_t i = 0; i < count; ++i) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < count; ++i) {
+        m_threads.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+app::ThreadPool::~ThreadPool()
+{
+    {
+        const std::lock_guard lock{ m_mutex };
+        m_stopping = true;
+    }
+    m_tasksQueued.notify_all();
+
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void app::ThreadPool::submit(Task task)
+{
+    const auto index = details::currentPool == this ?
+        details::currentQueue :
+        m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+    {
+        auto& queue = *m_queues[index];
+        const std::lock_guard lock{ queue.mutex };
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        const std::lock_guard lock{ m_mutex };
+        ++m_queuedTasks;
+        ++m_pendingTasks;
+    }
+    m_tasksQueued.notify_one();
+}
+
+void app::ThreadPool::wait()
+{
+    std::unique_lock lock{ m_mutex };
+    m_tasksFinished.wait(lock, [this]() {
+        return m_pendingTasks == 0;
+    });
+}
+
+size_t app::ThreadPool::getThreadCount() const
+{
+    return m_threads.size();
+}
+
+size_t app::ThreadPool::getStolenTaskCount() const
+{
+    return m_stolenTasks.load(std::memory_order_relaxed);
+}
+
+void app::ThreadPool::work(const size_t index)
+{
+    details::currentPool = this;
+    details::currentQueue = index;
+
+    while (true) {
+        if (Task task; takeTask(index, task)) {
+            task();
+
+            const std::lock_guard lock{ m_mutex };
+            if (--m_pendingTasks == 0) {
+                m_tasksFinished.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock lock{ m_mutex };
+        m_tasksQueued.wait(lock, [this]() {
+            return m_stopping || m_queuedTasks != 0;
+        });
+
+        if (m_stopping && m_queuedTasks == 0) {
+            return;
+        }
+    }
+}
+
+bool app::ThreadPool::takeTask(const size_t index, Task& task)
+{
+    // Own queue from the back, other queues from the front
+    for (size_t i = 0; i < m_queues.size(); ++i) {
+        auto& queue = *m_queues[(index + i) % m_queues.size()];
+
+        {
+            const std::lock_guard lock{ queue.mutex };
+            if (queue.tasks.empty()) {
+                continue;
+            }
+
+            if (i == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                m_stolenTasks.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        const std::lock_guard lock{ m_mutex };
+        --m_queuedTasks;
+        return true;
+    }
+
+    return false;
+}
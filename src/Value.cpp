@@ -0,0 +1,313 @@
+#include "Value.hpp"
+
+#include "CoreFunction.hpp"
+#include "CoreHeap.hpp"
+#include "CoreObject.hpp"
+#include "MemoryAccount.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+static_assert(sizeof(void*) == 8, "Value stores pointers in 48 bits");
+static_assert(sizeof(app::Value) == 8);
+
+// Text of a long string, or the two parts of a rope until it is flattened
+struct app::Value::StringData final
+{
+    std::string text;
+    Value left;
+    Value right;
+    size_t size;
+
+    size_t hash = 0;        // hash of the text, 0 until it is computed
+    bool interned = false;
+    MemoryAccount* account = nullptr;   // charged for the box and the capacity of the text
+
+    bool isRope() const
+    {
+        return left.tag() != Tag::Null;
+    }
+};
+
+app::Value::Value(const std::string& value) :
+    Value(std::string{ value })
+{
+}
+
+app::Value::Value(std::string&& value)
+{
+    if (value.size() > SHORT_STRING_SIZE) {
+        const auto size = value.size();
+        createBox(Tag::String, StringData{ std::move(value), Value{}, Value{}, size });
+        return;
+    }
+
+    // Size in the lowest byte, characters in the following ones
+    uint64_t payload = value.size();
+    for (size_t i = 0; i < value.size(); ++i) {
+        payload |= static_cast<uint64_t>(static_cast<unsigned char>(value[i])) << (8 * (i + 1));
+    }
+    m_bits = encode(Tag::ShortString, payload);
+}
+
+app::Value::Value(const CoreObjectPtr& value) :
+    m_bits(value ? encode(Tag::CoreObject, reinterpret_cast<uintptr_t>(value.get())) : encode(Tag::Null, 0))
+{
+    retain();
+}
+
+app::Value::Value(const CoreFunctionPtr& value) :
+    m_bits(value ? encode(Tag::CoreFunction, reinterpret_cast<uintptr_t>(value.get())) : encode(Tag::Null, 0))
+{
+    retain();
+}
+
+void app::retainReference(const CoreObject* object) noexcept
+{
+    object->retain();
+}
+
+void app::releaseReference(const CoreObject* object) noexcept
+{
+    if (object->releaseWithoutDelete()) {
+        CoreHeap::get().destroy(*object);
+    }
+}
+
+void app::retainReference(const CoreFunction* function) noexcept
+{
+    function->retain();
+}
+
+void app::releaseReference(const CoreFunction* function) noexcept
+{
+    function->release();
+}
+
+app::Value::Type app::Value::getType() const
+{
+    if (isNumber()) {
+        return Type::Number;
+    }
+
+    switch (tag()) {
+    case Tag::Null:
+        return Type::Null;
+    case Tag::Bool:
+        return Type::Bool;
+    case Tag::ScriptFunction:
+        return Type::ScriptFunction;
+    case Tag::ShortString:
+    case Tag::String:
+        return Type::String;
+    case Tag::Reference:
+        return Type::Reference;
+    case Tag::CoreObject:
+        return Type::CoreObject;
+    default:
+        return Type::CoreFunction;
+    }
+}
+
+template<typename T>
+void app::Value::createBox(const Tag tag, T&& value)
+{
+    auto* account = MemoryAccount::getCurrent();
+    if (account != nullptr) {
+        account->charge(MemoryAccount::Category::Strings, sizeof(Box<StringData>) + value.text.capacity());
+    }
+
+    auto* box = new Box<std::decay_t<T>>{ { 1 }, std::forward<T>(value) };
+    box->value.account = account;
+    m_bits = encode(tag, reinterpret_cast<uintptr_t>(box));
+}
+
+std::string app::Value::shortString() const
+{
+    const auto bits = payload();
+
+    std::string result(bits & 0xFF, '\0');
+    for (size_t i = 0; i < result.size(); ++i) {
+        result[i] = static_cast<char>((bits >> (8 * (i + 1))) & 0xFF);
+    }
+    return result;
+}
+
+const std::string& app::Value::flatString() const
+{
+    auto& data = box<StringData>()->value;
+    if (!data.isRope()) {
+        return data.text;
+    }
+
+    // Deep ropes are walked without recursion, left parts first
+    std::string text;
+    text.reserve(data.size);
+
+    std::vector<const Value*> parts{ &data.right, &data.left };
+    while (!parts.empty()) {
+        const auto* part = parts.back();
+        parts.pop_back();
+
+        if (part->tag() == Tag::String) {
+            const auto& partData = part->box<StringData>()->value;
+            if (partData.isRope()) {
+                parts.push_back(&partData.right);
+                parts.push_back(&partData.left);
+                continue;
+            }
+        }
+        part->appendString(text);
+    }
+
+    if (data.account != nullptr) {
+        data.account->charge(MemoryAccount::Category::Strings, text.capacity() - data.text.capacity());
+    }
+
+    data.text = std::move(text);
+    data.left = Value{};
+    data.right = Value{};
+    return data.text;
+}
+
+app::Value app::Value::intern(const std::string& text)
+{
+    Value value{ text };
+    if (value.tag() != Tag::String) {
+        return value;
+    }
+
+    // Literals live until their thread exits, keys view the text of their boxes.
+    // Boxes are counted without atomics, so every thread interns its own
+    thread_local std::unordered_map<std::string_view, Value> strings;
+
+    auto& data = value.box<StringData>()->value;
+    const auto [it, inserted] = strings.try_emplace(data.text, value);
+    if (inserted) {
+        data.interned = true;
+    }
+
+    return it->second;
+}
+
+app::Value app::Value::concatenate(const Value& left, const Value& right)
+{
+    if (left.stringSize() == 0) {
+        return right;
+    }
+    if (right.stringSize() == 0) {
+        return left;
+    }
+
+    const auto size = left.stringSize() + right.stringSize();
+    if (size < MIN_ROPE_SIZE) {
+        std::string text;
+        text.reserve(size);
+        left.appendString(text);
+        right.appendString(text);
+        return Value{ std::move(text) };
+    }
+
+    Value result;
+    result.createBox(Tag::String, StringData{ std::string{}, left, right, size });
+    return result;
+}
+
+bool app::Value::equalStrings(const Value& left, const Value& right)
+{
+    if (left.m_bits == right.m_bits) {
+        return true;
+    }
+    if (left.stringSize() != right.stringSize()) {
+        return false;
+    }
+    if (left.tag() == Tag::ShortString || right.tag() == Tag::ShortString) {
+        return false;
+    }
+
+    const auto& leftData = left.box<StringData>()->value;
+    const auto& rightData = right.box<StringData>()->value;
+    if ((leftData.interned && rightData.interned) || left.stringHash() != right.stringHash()) {
+        return false;
+    }
+
+    return left.flatString() == right.flatString();
+}
+
+size_t app::Value::stringHash() const
+{
+    auto& data = box<StringData>()->value;
+    if (data.hash == 0) {
+        data.hash = std::hash<std::string_view>{}(flatString());
+    }
+
+    return data.hash;
+}
+
+size_t app::Value::stringSize() const
+{
+    return tag() == Tag::ShortString ? payload() & 0xFF : box<StringData>()->value.size;
+}
+
+void app::Value::appendString(std::string& text) const
+{
+    if (tag() != Tag::ShortString) {
+        text.append(flatString());
+        return;
+    }
+
+    const auto bits = payload();
+    for (size_t i = 0; i < (bits & 0xFF); ++i) {
+        text.push_back(static_cast<char>((bits >> (8 * (i + 1))) & 0xFF));
+    }
+}
+
+void app::Value::retainCore() const
+{
+    if (tag() == Tag::CoreObject) {
+        reinterpret_cast<const CoreObject*>(payload())->retain();
+    }
+    else {
+        reinterpret_cast<const CoreFunction*>(payload())->retain();
+    }
+}
+
+void app::Value::releaseCore() const
+{
+    if (tag() == Tag::CoreObject) {
+        releaseReference(reinterpret_cast<const CoreObject*>(payload()));
+    }
+    else {
+        reinterpret_cast<const CoreFunction*>(payload())->release();
+    }
+}
+
+void app::Value::destroy()
+{
+    destroyString(box<StringData>());
+}
+
+void app::Value::destroyString(Box<StringData>* root)
+{
+    // Parts of ropes are released here, recursive destructors could overflow the stack
+    std::vector<Box<StringData>*> boxes;
+
+    for (auto* current = root; current != nullptr; ) {
+        for (auto* part : { &current->value.left, &current->value.right }) {
+            if (part->tag() == Tag::String && --part->header()->references == 0) {
+                boxes.push_back(part->box<StringData>());
+            }
+            part->m_bits = encode(Tag::Null, 0);
+        }
+        if (auto* account = current->value.account; account != nullptr) {
+            account->discharge(MemoryAccount::Category::Strings, sizeof(Box<StringData>) + current->value.text.capacity());
+        }
+        delete current;
+
+        current = nullptr;
+        if (!boxes.empty()) {
+            current = boxes.back();
+            boxes.pop_back();
+        }
+    }
+}
@@ -0,0 +1,344 @@
+#include "VariableResolver.hpp"
+
+#include <stack>
+#include <algorithm>
+
+using namespace app::bytecode_analysis;
+
+bool app::VariableResolver::resolve(std::vector<ByteCodeItem>& byteCode)
+{
+    m_byteCode = &byteCode;
+
+    const auto size = byteCode.size();
+    m_frameEntries.assign(1, 0);
+    m_frameOf.assign(size, 0);
+    m_nameItems.assign(size, NO_INDEX);
+    m_operands = analyzeOperands(byteCode);
+    m_visited.assign(size, false);
+    m_resolved.assign(size, NO_INDEX);
+    m_removedBlock.assign(size, NO_INDEX);
+    m_declarations.clear();
+    m_declarationAt.clear();
+    m_declarationsByName.clear();
+    m_freeNames.clear();
+
+    for (size_t i = 0; i < size; ++i) {
+        const auto consumer = m_operands[i].consumer;
+        if (consumer != NO_INDEX && isDeclaration(byteCode[consumer])) {
+            m_nameItems[consumer] = i;
+        }
+    }
+
+    auto success = findFrames();
+    for (size_t frame = 0; success && frame < m_frameEntries.size(); ++frame) {
+        success = analyzeFrame(frame);
+    }
+
+    if (success) {
+        assignSlots();
+        rewrite();
+    }
+
+    m_byteCode = nullptr;
+
+    return success;
+}
+
+bool app::VariableResolver::findFrames()
+{
+    // function declaration: var name, ptr start, DECLFUN, ptr end, JMP
+    const auto& byteCode = *m_byteCode;
+
+    for (size_t i = 1; i + 2 < byteCode.size(); ++i) {
+        if (!isOp(byteCode[i], OpCode::DECLFUN)) {
+            continue;
+        }
+
+        const auto* start = std::get_if<Pointer>(&byteCode[i - 1]);
+        const auto* end = std::get_if<Pointer>(&byteCode[i + 1]);
+        if (start == nullptr || end == nullptr || !isOp(byteCode[i + 2], OpCode::JMP) ||
+            *start > *end || *end > byteCode.size())
+        {
+            return false;
+        }
+
+        const auto frame = m_frameEntries.size();
+        m_frameEntries.push_back(*start);
+
+        for (auto j = *start; j < *end; ++j) {
+            if (m_frameOf[j] != 0) {
+                return false;
+            }
+            m_frameOf[j] = frame;
+        }
+    }
+
+    return true;
+}
+
+bool app::VariableResolver::analyzeFrame(const size_t frame)
+{
+    const auto& byteCode = *m_byteCode;
+
+    // Scope of each visited position must not depend on the path
+    std::vector<Environment> environments(byteCode.size());
+
+    const auto pointerAt = [&byteCode](const size_t position) -> const Pointer* {
+        return position < byteCode.size() ? std::get_if<Pointer>(&byteCode[position]) : nullptr;
+    };
+
+    std::stack<std::pair<size_t, Environment>> pending;
+    pending.emplace(m_frameEntries[frame], frame == 0 ? Environment{ Block{ NO_INDEX, {} } } : Environment{});
+
+    while (!pending.empty()) {
+        auto[position, environment] = std::move(pending.top());
+        pending.pop();
+
+        if (position >= byteCode.size()) {
+            if (frame != 0) {
+                return false;
+            }
+            continue;
+        }
+
+        if (m_frameOf[position] != frame) {
+            return false;
+        }
+
+        if (m_visited[position]) {
+            if (environments[position] != environment) {
+                return false;
+            }
+            continue;
+        }
+
+        m_visited[position] = true;
+        environments[position] = environment;
+
+        const auto& item = byteCode[position];
+
+        if (const auto* name = std::get_if<std::string_view>(&item); name != nullptr && isReference(position)) {
+            for (auto block = environment.rbegin(); block != environment.rend(); ++block) {
+                const auto it = std::find_if(block->declarations.rbegin(), block->declarations.rend(),
+                    [name](const auto& declaration) { return declaration.first == *name; });
+
+                if (it != block->declarations.rend()) {
+                    m_resolved[position] = it->second;
+                    break;
+                }
+            }
+
+            if (m_resolved[position] == NO_INDEX && frame != 0) {
+                m_freeNames.insert(*name);
+            }
+        }
+
+        const auto* op = std::get_if<OpCode>(&item);
+        if (op == nullptr) {
+            pending.emplace(position + 1, std::move(environment));
+            continue;
+        }
+
+        switch (*op) {
+        case OpCode::DECLVAR:
+        case OpCode::DECLFUN:
+        case OpCode::DECLARG:
+        case OpCode::DECLARGREF:
+        {
+            const auto nameItem = m_nameItems[position];
+            if (environment.empty() || nameItem == NO_INDEX ||
+                !std::holds_alternative<std::string_view>(byteCode[nameItem]))
+            {
+                return false;
+            }
+
+            const auto name = std::get<std::string_view>(byteCode[nameItem]);
+            auto& block = environment.back();
+
+            // Redeclaration fails at runtime, named lookup keeps the error
+            const auto isDeclared = std::any_of(block.declarations.begin(), block.declarations.end(),
+                [name](const auto& declaration) { return declaration.first == name; });
+            if (isDeclared) {
+                return false;
+            }
+
+            m_declarationsByName[name].push_back(position);
+            m_declarations.push_back(Declaration{ name, position, nameItem, frame,
+                environment.size() - 1, block.definition, NO_INDEX });
+
+            block.declarations.emplace_back(name, position);
+            pending.emplace(position + 1, std::move(environment));
+            break;
+        }
+
+        case OpCode::DEFBLOCK:
+            environment.push_back(Block{ position, {} });
+            pending.emplace(position + 1, std::move(environment));
+            break;
+
+        case OpCode::DELBLOCK:
+            if (environment.empty() || environment.back().definition == NO_INDEX) {
+                return false;
+            }
+
+            m_removedBlock[position] = environment.back().definition;
+            environment.pop_back();
+            pending.emplace(position + 1, std::move(environment));
+            break;
+
+        case OpCode::JMP:
+        {
+            const auto* target = pointerAt(position - 1);
+            if (target == nullptr) {
+                return false;
+            }
+            pending.emplace(*target, std::move(environment));
+            break;
+        }
+
+        case OpCode::IF:
+        case OpCode::LT_JMP:
+        {
+            const auto* truePointer = pointerAt(position - 2);
+            const auto* falsePointer = pointerAt(position - 1);
+            if (truePointer == nullptr || falsePointer == nullptr) {
+                return false;
+            }
+            pending.emplace(*truePointer, environment);
+            pending.emplace(*falsePointer, std::move(environment));
+            break;
+        }
+
+        case OpCode::RET:
+            break;
+
+        default:
+            pending.emplace(position + 1, std::move(environment));
+            break;
+        }
+    }
+
+    return true;
+}
+
+void app::VariableResolver::assignSlots()
+{
+    std::sort(m_declarations.begin(), m_declarations.end(), [](const auto& left, const auto& right) {
+        return left.position < right.position;
+    });
+
+    for (size_t i = 0; i < m_declarations.size(); ++i) {
+        m_declarationAt.emplace(m_declarations[i].position, i);
+    }
+
+    std::vector<size_t> slotCounts(m_frameEntries.size(), 0);
+
+    for (auto& declaration : m_declarations) {
+        if (!isDynamic(declaration.name)) {
+            declaration.slot = slotCounts[declaration.frame]++;
+        }
+    }
+}
+
+void app::VariableResolver::rewrite()
+{
+    auto& byteCode = *m_byteCode;
+
+    const auto slotOf = [](const Declaration& declaration) -> ByteCodeItem {
+        if (declaration.frame == 0) {
+            return makeSlot<GlobalSlot>(declaration.slot, declaration.name);
+        }
+        return makeSlot<LocalSlot>(declaration.slot, declaration.name);
+    };
+
+    std::unordered_set<size_t> namedBlocks;
+
+    for (const auto& declaration : m_declarations) {
+        if (declaration.slot == NO_INDEX) {
+            namedBlocks.insert(declaration.block);
+        }
+    }
+
+    std::vector<bool> removed(byteCode.size(), false);
+
+    for (size_t i = 0; i < byteCode.size(); ++i) {
+        if (!m_visited[i]) {
+            continue;
+        }
+
+        if (isOp(byteCode[i], OpCode::DEFBLOCK)) {
+            removed[i] = namedBlocks.count(i) == 0;
+            continue;
+        }
+        if (isOp(byteCode[i], OpCode::DELBLOCK)) {
+            removed[i] = namedBlocks.count(m_removedBlock[i]) == 0;
+            continue;
+        }
+
+        const auto* name = std::get_if<std::string_view>(&byteCode[i]);
+        if (name == nullptr || isDynamic(*name)) {
+            continue;
+        }
+
+        if (m_resolved[i] != NO_INDEX) {
+            byteCode[i] = slotOf(m_declarations[m_declarationAt.at(m_resolved[i])]);
+        }
+        else if (m_frameOf[i] != 0 && isReference(i)) {
+            if (const auto* global = findGlobal(*name); global != nullptr) {
+                byteCode[i] = slotOf(*global);
+            }
+        }
+    }
+
+    for (const auto& declaration : m_declarations) {
+        if (declaration.slot != NO_INDEX) {
+            byteCode[declaration.nameItem] = slotOf(declaration);
+        }
+    }
+
+    removeItems(byteCode, removed);
+}
+
+bool app::VariableResolver::isReference(const size_t position) const
+{
+    const auto& operand = m_operands[position];
+    if (operand.consumer == NO_INDEX) {
+        return true;
+    }
+
+    const auto& consumer = (*m_byteCode)[operand.consumer];
+
+    if (isOp(consumer, OpCode::STRUCTREF)) {
+        return operand.slot != 0;
+    }
+
+    return !isDeclaration(consumer);
+}
+
+const app::VariableResolver::Declaration* app::VariableResolver::findGlobal(const std::string_view name) const
+{
+    const auto it = m_declarationsByName.find(name);
+    if (it == m_declarationsByName.end()) {
+        return nullptr;
+    }
+
+    // Declarations of other functions and nested top level blocks are not visible to functions
+    const Declaration* result = nullptr;
+    for (const auto position : it->second) {
+        const auto& declaration = m_declarations[m_declarationAt.at(position)];
+        if (declaration.frame != 0 || declaration.depth != 0) {
+            continue;
+        }
+        if (result != nullptr) {
+            return nullptr;
+        }
+        result = &declaration;
+    }
+
+    return result;
+}
+
+bool app::VariableResolver::isDynamic(const std::string_view name) const
+{
+    return m_freeNames.count(name) != 0 && findGlobal(name) == nullptr;
+}
@@ -0,0 +1,205 @@
+#include "Verifier.hpp"
+
+#include <algorithm>
+
+bool app::Verifier::verify(const std::vector<ByteCodeItem>& byteCode)
+{
+    m_byteCode = &byteCode;
+    m_functions.clear();
+
+    auto success = verifyFrame(0, false);
+
+    // Frames append functions which they declare
+    for (size_t i = 0; success && i < m_functions.size(); ++i) {
+        success = verifyFrame(m_functions[i], true);
+    }
+
+    m_byteCode = nullptr;
+    m_states.clear();
+    m_pending.clear();
+
+    return success;
+}
+
+bool app::Verifier::verifyFrame(const Pointer entry, const bool isFunction)
+{
+    const auto& byteCode = *m_byteCode;
+
+    m_states.assign(byteCode.size(), std::nullopt);
+    m_pending.clear();
+
+    merge(entry, State{ 0, 0, {} });
+
+    while (!m_pending.empty()) {
+        const auto position = m_pending.back();
+        m_pending.pop_back();
+
+        auto state = *m_states[position];
+
+        const auto popValues = [&state](const size_t count) {
+            if (state.values < count) {
+                return false;
+            }
+            state.values -= count;
+            return true;
+        };
+
+        const auto popPointer = [&state](Pointer& pointer) {
+            if (state.pointers.empty()) {
+                return false;
+            }
+            pointer = state.pointers.back();
+            state.pointers.pop_back();
+            return true;
+        };
+
+        const auto* op = std::get_if<OpCode>(&byteCode[position]);
+        if (op == nullptr) {
+            if (const auto* pointer = std::get_if<Pointer>(&byteCode[position]); pointer != nullptr) {
+                state.pointers.push_back(*pointer);
+            }
+            else {
+                ++state.values;
+            }
+
+            if (!merge(position + 1, state)) {
+                return false;
+            }
+            continue;
+        }
+
+        auto success = true;
+        auto next = std::optional<Pointer>{ position + 1 };
+
+        switch (*op) {
+        case OpCode::DECLVAR:
+        case OpCode::DECLARG:
+        case OpCode::DECLARGREF:
+        case OpCode::PUSHARG:
+        case OpCode::POP:
+            success = popValues(1);
+            break;
+
+        case OpCode::DECLFUN:
+        {
+            Pointer function = 0;
+            success = popValues(1) && popPointer(function);
+            if (success && std::find(m_functions.begin(), m_functions.end(), function) == m_functions.end()) {
+                m_functions.push_back(function);
+            }
+            break;
+        }
+
+        case OpCode::ASSIGN:
+        case OpCode::ASSIGNREF:
+        case OpCode::INCVAR:
+            success = popValues(2);
+            break;
+
+        case OpCode::DEREF:
+        case OpCode::NOT:
+        case OpCode::UNM:
+            success = popValues(1);
+            ++state.values;
+            break;
+
+        case OpCode::CALL:
+        case OpCode::STRUCTREF:
+            success = popValues(2);
+            ++state.values;
+            break;
+
+        case OpCode::TAILCALL:
+            // Reused frame must have only the return pointer of our caller
+            success = popValues(2) && (!isFunction || state.pointers.empty());
+            ++state.values;
+            break;
+
+        case OpCode::CALL_MEMBER:
+            success = popValues(3);
+            ++state.values;
+            break;
+
+        case OpCode::IF:
+        case OpCode::LT_JMP:
+        {
+            Pointer truePointer = 0;
+            Pointer falsePointer = 0;
+            success = popValues(*op == OpCode::IF ? 1 : 2) && popPointer(falsePointer) && popPointer(truePointer);
+            if (success) {
+                success = merge(truePointer, state);
+                next = falsePointer;
+            }
+            break;
+        }
+
+        case OpCode::JMP:
+        {
+            Pointer target = 0;
+            success = popPointer(target);
+            next = target;
+            break;
+        }
+
+        case OpCode::RET:
+            success = isFunction && popValues(1) && state.pointers.empty();
+            next = std::nullopt;
+            break;
+
+        case OpCode::DEFBLOCK:
+            ++state.blocks;
+            break;
+
+        case OpCode::DELBLOCK:
+            success = state.blocks > 0;
+            --state.blocks;
+            break;
+
+        default:
+            if (isBinaryMathOp(*op) || isLogicOp(*op) || isComparisonOp(*op)) {
+                success = popValues(2);
+                ++state.values;
+            }
+            else {
+                success = false;
+            }
+            break;
+        }
+
+        if (!success || (next.has_value() && !merge(*next, state))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool app::Verifier::merge(const size_t position, const State& state)
+{
+    // Execution stops at the end of the code
+    if (position >= m_states.size()) {
+        return true;
+    }
+
+    auto& current = m_states[position];
+    if (!current.has_value()) {
+        current = state;
+        m_pending.push_back(position);
+        return true;
+    }
+
+    if (current->pointers != state.pointers) {
+        return false;
+    }
+
+    const auto values = std::min(current->values, state.values);
+    const auto blocks = std::min(current->blocks, state.blocks);
+
+    if (values != current->values || blocks != current->blocks) {
+        current->values = values;
+        current->blocks = blocks;
+        m_pending.push_back(position);
+    }
+
+    return true;
+}
@@ -1,9 +1,22 @@
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <thread>
 #include <Evaluator.hpp>
 
+#include "Allocations.hpp"
+#include "CoreHeap.hpp"
 #include "Lexer.hpp"
+#include "MemoryAccount.hpp"
 #include "Parser.hpp"
+#include "Optimizer.hpp"
+#include "Profiler.hpp"
+#include "RegisterCompiler.hpp"
+#include "RegisterEvaluator.hpp"
+#include "ScriptHost.hpp"
+#include "Verifier.hpp"
 
 #include "StandardLibrary.hpp"
 
@@ -32,6 +45,47 @@ struct Arguments final
             else if (arg == "-p" || arg == "--process") {
                 showExecutionProcess = true;
             }
+            else if (arg == "-n" || arg == "--no-optimize") {
+                optimizationEnabled = false;
+            }
+            else if (arg == "-r" || arg == "--registers") {
+                useRegisterMachine = true;
+            }
+            else if (arg == "--no-jit") {
+                jitEnabled = false;
+            }
+            else if (arg == "-s" || arg == "--stats") {
+                showStatistics = true;
+            }
+            else if (arg == "-f" || arg == "--profile") {
+                showProfile = true;
+            }
+            else if (arg == "--slice" && i + 1 < argc) {
+                sliceSize = std::strtoull(argv[++i], nullptr, 10);
+                showHelpMessage = sliceSize == 0;
+            }
+            else if (arg == "--mem-stats") {
+                showMemoryStatistics = true;
+            }
+            else if (arg == "--mem-quota" && i + 1 < argc) {
+                memoryQuota = std::strtoull(argv[++i], nullptr, 10);
+                showHelpMessage = memoryQuota == 0;
+            }
+            else if (arg == "--serve-dir" && i + 1 < argc) {
+                serveDirectory = argv[++i];
+            }
+            else if (arg == "--threads" && i + 1 < argc) {
+                threadCount = std::strtoull(argv[++i], nullptr, 10);
+                showHelpMessage = threadCount == 0;
+            }
+            else if (arg == "--repeat" && i + 1 < argc) {
+                repeatCount = std::strtoull(argv[++i], nullptr, 10);
+                showHelpMessage = repeatCount == 0;
+            }
+            else if ((arg == "-d" || arg == "--depth") && i + 1 < argc) {
+                stackLimit = std::strtoull(argv[++i], nullptr, 10);
+                showHelpMessage = stackLimit == 0;
+            }
             else if (arg == "-h") {
                 showHelpMessage = true;
             }
@@ -49,7 +103,19 @@ struct Arguments final
     bool showSyntaxTree = false;
     bool showGeneratedByteCode = false;
     bool showExecutionProcess = false;
+    bool optimizationEnabled = true;
+    bool useRegisterMachine = false;
+    bool jitEnabled = true;
+    bool showStatistics = false;
+    bool showProfile = false;
     bool showHelpMessage = false;
+    size_t stackLimit = app::Stack<size_t>::DEFAULT_LIMIT;
+    size_t sliceSize = 0;
+    bool showMemoryStatistics = false;
+    size_t memoryQuota = app::MemoryAccount::NO_QUOTA;
+    std::string serveDirectory = "";
+    size_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    size_t repeatCount = 1;
 };
 
 void printHelp(int argc, char** argv)
@@ -57,16 +123,128 @@ void printHelp(int argc, char** argv)
     std::cout <<
         "USL - useless scripting language.\n\n"
         "Usage:\n"
-        "\t"	"usl [<file>] [option]...\n\n"
+        "\t"	"usl [<file>] [option]...\n"
+        "\t"	"usl --serve-dir <dir> [option]...\n\n"
         "Options:\n"
         "\t"	"-a, --all\tShow all debug information\n"
         "\t"	"-l, --lexer\tShow lexer output\n"
         "\t"	"-t, --tree\tShow abstract syntax tree\n"
         "\t"	"-b, --bytecode\tShow generated bytecode\n"
         "\t"	"-p, --process\tShow execution process\n"
+        "\t"	"-n, --no-optimize\tDisable bytecode optimizations\n"
+        "\t"	"-r, --registers\tRun on register-based virtual machine\n"
+        "\t"	"--no-jit\tDon't compile hot functions of register code to native code\n"
+        "\t"	"-s, --stats\tShow execution statistics\n"
+        "\t"	"-f, --profile\tShow most frequent instruction sequences\n"
+        "\t"	"--slice <n>\tRun the stack evaluator in slices of about n instructions\n"
+        "\t"	"--mem-stats\tShow memory used by the script\n"
+        "\t"	"--mem-quota <n>\tMaximum number of bytes the script can use\n"
+        "\t"	"--serve-dir <dir>\tEvaluate all scripts of the directory concurrently\n"
+        "\t"	"--threads <n>\tNumber of threads evaluating the scripts of --serve-dir\n"
+        "\t"	"--repeat <n>\tNumber of evaluations of each script of --serve-dir\n"
+        "\t"	"-d, --depth <n>\tMaximum depth of evaluator stacks\n"
         "\t"	"-h, --help\tShow this message\n";
 }
 
+bool readText(const std::string& filename, std::string& text)
+{
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file.seekg(0, std::ios::end);
+    text.reserve(file.tellg());
+    file.seekg(0, std::ios::beg);
+
+    text.assign(
+        std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>());
+    return true;
+}
+
+const char* toString(const app::Evaluator::Status status)
+{
+    switch (status) {
+    case app::Evaluator::Status::Yielded:
+        return "yielded";
+    case app::Evaluator::Status::Finished:
+        return "finished";
+    default:
+        return "error";
+    }
+}
+
+// Evaluates every script of the directory the given number of times on a pool of threads
+int serve(const Arguments& arguments)
+{
+    namespace fs = std::filesystem;
+
+    std::vector<fs::path> paths;
+    try {
+        for (const auto& entry : fs::directory_iterator(arguments.serveDirectory)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+                paths.push_back(entry.path());
+            }
+        }
+    }
+    catch (const fs::filesystem_error& e) {
+        std::cerr << "Unable to read directory: " << e.what() << std::endl;
+        return 1;
+    }
+    std::sort(paths.begin(), paths.end());
+
+    // Scripts are compiled once, their evaluations share the bytecode
+    std::vector<std::unique_ptr<const app::Program>> programs;
+    for (const auto& path : paths) {
+        std::string text;
+        if (!readText(path.string(), text)) {
+            std::cerr << "Unable to open file: " << path.string() << std::endl;
+            continue;
+        }
+
+        try {
+            programs.push_back(app::ScriptHost::compile(path.filename().string(), std::move(text), arguments.optimizationEnabled));
+        }
+        catch (const std::runtime_error& e) {
+            std::cout << path.filename().string() << ": ERR: " << e.what() << std::endl;
+        }
+    }
+
+    app::ScriptHost host{ arguments.threadCount };
+    host.setStackLimit(arguments.stackLimit);
+    host.setMemoryQuota(arguments.memoryQuota);
+
+    std::vector<app::ScriptHost::Result> results(programs.size() * arguments.repeatCount);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < results.size(); ++i) {
+        host.submit(*programs[i % programs.size()], results[i]);
+    }
+    host.wait();
+    const std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+
+    // Results of the first evaluation of each script
+    auto failed = false;
+    for (size_t i = 0; i < programs.size(); ++i) {
+        const auto& result = results[i];
+        failed = failed || result.status != app::Evaluator::Status::Finished;
+
+        printf("== %s: %s, %zu instructions, %zu bytes peak\n", programs[i]->name.c_str(),
+            toString(result.status), result.instructionCount, result.peakMemory);
+        printf("%s", result.output.c_str());
+        if (!result.error.empty()) {
+            printf("ERR: %s\n", result.error.c_str());
+        }
+    }
+
+    printf("Evaluated %zu scripts on %zu threads in %.3f s: %.1f scripts/s, %zu stolen\n",
+        results.size(), host.getPool().getThreadCount(), time.count(),
+        time.count() > 0 ? results.size() / time.count() : 0.0, host.getPool().getStolenTaskCount());
+
+    return failed ? 1 : 0;
+}
+
 int main(const int argc, char** argv)
 {
     // Handle console arguments
@@ -77,22 +255,15 @@ int main(const int argc, char** argv)
         return 0;
     }
 
-    std::ifstream file(arguments.filename);
-    if (!file.is_open()) {
-        std::cerr << "Unable to open file: " << arguments.filename << std::endl;
-        return 1;
+    if (!arguments.serveDirectory.empty()) {
+        return serve(arguments);
     }
 
-    // Read program text
     std::string text;
-
-    file.seekg(0, std::ios::end);
-    text.reserve(file.tellg());
-    file.seekg(0, std::ios::beg);
-
-    text.assign(
-        std::istreambuf_iterator<char>(file),
-        std::istreambuf_iterator<char>());
+    if (!readText(arguments.filename, text)) {
+        std::cerr << "Unable to open file: " << arguments.filename << std::endl;
+        return 1;
+    }
 
     try {
         // Generate tokens
@@ -108,7 +279,12 @@ int main(const int argc, char** argv)
 
         // Parse tokens
         app::Parser parser{ arguments.showSyntaxTree };
-        const auto& byteCode = parser.parse(tokens);
+        auto byteCode = parser.parse(tokens);
+
+        if (arguments.optimizationEnabled) {
+            app::Optimizer optimizer;
+            byteCode = optimizer.optimize(byteCode);
+        }
 
         if (arguments.showGeneratedByteCode) {
             printf("Generated bytecode: \n");
@@ -120,12 +296,112 @@ int main(const int argc, char** argv)
         }
 
         // Evaluate
-        app::Evaluator evaluator{ arguments.showExecutionProcess };
+        app::Evaluator evaluator{ arguments.showExecutionProcess && !arguments.useRegisterMachine };
+        evaluator.setStackLimit(arguments.stackLimit);
+        evaluator.getMemory().setQuota(arguments.memoryQuota);
 
-        auto standardLibrary = std::make_shared<app::StandardLibrary>();
+        auto standardLibrary = app::makeRef<app::StandardLibrary>();
         evaluator.registerVariable("std", standardLibrary);
 
-        evaluator.eval(byteCode);
+        size_t instructionCount = 0;
+        const auto allocationCount = app::getAllocationCount();
+        const auto allocatedSize = app::getAllocatedSize();
+        if (arguments.useRegisterMachine) {
+            app::RegisterCompiler compiler;
+            const auto program = compiler.compile(byteCode);
+
+            if (arguments.showGeneratedByteCode) {
+                printf("Generated register code: \n");
+                for (size_t i = 0; i < program.instructions.size(); ++i) {
+                    printf("[%3zu] ", i);
+                    print(program, program.instructions[i]);
+                    printf("\n");
+                }
+            }
+
+            app::RegisterEvaluator registerEvaluator{ evaluator, arguments.showExecutionProcess, arguments.jitEnabled };
+            registerEvaluator.eval(program);
+
+            instructionCount = registerEvaluator.getInstructionCount();
+
+            if (arguments.showStatistics) {
+                registerEvaluator.printTiers();
+            }
+        }
+        else {
+            app::Profiler profiler;
+            if (arguments.showProfile) {
+                evaluator.setProfiler(&profiler);
+            }
+
+            const auto verified = app::Verifier{}.verify(byteCode);
+            if (arguments.showStatistics) {
+                printf("Bytecode verified: %s\n", verified ? "yes" : "no");
+            }
+
+            if (arguments.sliceSize == 0) {
+                evaluator.eval(byteCode, verified);
+            }
+            else {
+                // Resume the evaluation until it finishes, as a host interleaving scripts would
+                size_t slices = 0;
+                auto status = app::Evaluator::Status::Yielded;
+
+                evaluator.load(byteCode, verified);
+                while (status == app::Evaluator::Status::Yielded) {
+                    status = evaluator.run(arguments.sliceSize);
+                    ++slices;
+                }
+
+                if (status == app::Evaluator::Status::Error) {
+                    throw std::runtime_error{ evaluator.getError() };
+                }
+                if (arguments.showStatistics) {
+                    printf("Slices: %zu\n", slices);
+                }
+            }
+
+            instructionCount = evaluator.getInstructionCount();
+
+            if (arguments.showProfile) {
+                evaluator.setProfiler(nullptr);
+                profiler.print(10);
+            }
+        }
+
+        if (arguments.showStatistics) {
+            printf("Executed instructions: %zu\n", instructionCount);
+
+            const auto allocations = app::getAllocationCount() - allocationCount;
+            printf("Allocations: %zu (%.3f per instruction), %zu bytes\n", allocations,
+                instructionCount == 0 ? 0.0 : static_cast<double>(allocations) / instructionCount,
+                app::getAllocatedSize() - allocatedSize);
+
+            const auto& heap = app::CoreHeap::get().getStatistics();
+            printf("Core heap: %zu bytes, %zu objects in nursery, %zu old\n",
+                heap.heapSize, heap.nurseryObjects, heap.oldObjects);
+            printf("Collections: %zu minor, %zu major, %zu objects freed, pauses %.3f ms total, %.3f ms max\n",
+                heap.minorCollections, heap.majorCollections, heap.collectedObjects,
+                std::chrono::duration<double, std::milli>(heap.totalPause).count(),
+                std::chrono::duration<double, std::milli>(heap.maxPause).count());
+        }
+
+        if (arguments.showMemoryStatistics) {
+            using Category = app::MemoryAccount::Category;
+            const auto& memory = evaluator.getMemory();
+
+            printf("Memory: %zu bytes live, %zu peak", memory.getLiveSize(), memory.getPeakSize());
+            if (memory.getQuota() != app::MemoryAccount::NO_QUOTA) {
+                printf(", quota %zu", memory.getQuota());
+            }
+            printf("\n");
+
+            for (auto i = 0; i < static_cast<int>(Category::Count); ++i) {
+                const auto category = static_cast<Category>(i);
+                printf("  %-8s %10zu live %10zu peak\n", app::MemoryAccount::getName(category),
+                    memory.getLiveSize(category), memory.getPeakSize(category));
+            }
+        }
     }
     catch (const std::runtime_error & e) {
         std::cout << "ERR: " << e.what() << std::endl;